@@ -2,6 +2,13 @@
  * I2C Character Driver for Raspberry Pi 4
  * Communicates with STM32F401RE slave at address 0x30
  * Sends data byte 0xAA
+ * General-call broadcast writes reach every slave on the adapter at once
+ * hrtimer-driven sampling streams timestamped register blocks to
+ * /dev/i2c_stm32_capture
+ * readv()/writev() gather all segments into a single I2C transaction
+ * Bus speed is calibrated at runtime with a loopback test against the firmware
+ * /dev/i2c_stm32_stripe stripes one stream across several adapters in parallel
+ * Optional per-bus transfer kthreads with RT priority and CPU affinity
  */
 
 #include <linux/module.h>
@@ -13,10 +20,105 @@
 #include <linux/i2c.h>
 #include <linux/uaccess.h>
 #include <linux/slab.h>
+#include <linux/hrtimer.h>
+#include <linux/ktime.h>
+#include <linux/kfifo.h>
+#include <linux/workqueue.h>
+#include <linux/wait.h>
+#include <linux/poll.h>
+#include <linux/mutex.h>
+#include <linux/rwsem.h>
+#include <linux/uio.h>
+#include <linux/of.h>
+#include <linux/random.h>
+#include <linux/jiffies.h>
+#include <linux/moduleparam.h>
+#include <linux/kthread.h>
+#include <linux/sched.h>
+#include <linux/sched/types.h>
+#include <linux/cpumask.h>
+#include <linux/completion.h>
+#include <linux/list.h>
+#include <linux/spinlock.h>
 
 #define DRIVER_NAME "i2c_stm32"
 #define DEVICE_NAME "i2c_stm32"
 #define STM32_I2C_ADDR 0x30
+#define I2C_GENERAL_CALL_ADDR 0x00
+#define STM32_MAX_XFER 256     /* Largest single read/write transaction */
+#define STM32_NR_MINORS 3      /* raw, capture, stripe */
+
+/* General call commands understood by the STM32 firmware */
+#define STM32_GC_CMD_RESET   0x06
+#define STM32_GC_CMD_CONFIG  0x08
+#define STM32_GC_CMD_SYNC    0x0A
+#define STM32_GC_CMD_LED_ON  0x0C
+#define STM32_GC_CMD_LED_OFF 0x0E
+#define STM32_GC_MAX_LEN     32
+
+/* Periodic sampling */
+#define CAPTURE_DEVICE_NAME      "i2c_stm32_capture"
+#define STM32_SAMPLE_MAX_LEN     32
+#define STM32_SAMPLE_FIFO_LEN    256   /* records, must be a power of 2 */
+#define STM32_SAMPLE_MAX_HZ      2000
+#define STM32_REG_LOOP_COUNT     0xE0  /* Default block: firmware status */
+
+/* Bus speed calibration */
+#define STM32_CALIB_REG          0xC0  /* Scratch block in the register file */
+#define STM32_CALIB_LEN          32
+#define STM32_CALIB_ROUNDS       50    /* Loopback rounds per speed */
+#define STM32_ERR_WINDOW_MS      10000
+#define STM32_ERR_THRESHOLD      10    /* Errors per window that trigger recalibration */
+
+/* Candidate speeds, slowest first (STM32F401 slave tops out at 400 kHz) */
+static const unsigned int stm32_calib_speeds[] = { 100000, 200000, 300000, 400000 };
+
+/* Multi-bus striping */
+#define STRIPE_DEVICE_NAME       "i2c_stm32_stripe"
+#define STM32_REG_STRIPE         0xF0  /* Chunk port: seq_lo seq_hi len data[len] */
+#define STM32_REG_STRIPE_RESET   0xF1  /* Restart firmware reassembly at seq 0 */
+#define STM32_REG_STRIPE_SEQ     0xE9  /* Next seq the firmware expects, 16-bit LE */
+#define STM32_STRIPE_HDR_LEN     3
+#define STM32_STRIPE_CHUNK_MAX   32
+#define STM32_STRIPE_WINDOW      16    /* Firmware reassembly slots, in chunks */
+#define STM32_STRIPE_MAX_LINKS   4
+#define STM32_STRIPE_MAX_WRITE   4096
+#define STM32_STRIPE_RETRIES     2     /* Firmware drops duplicates, so resend is safe */
+
+/* One bus to the STM32: carries part of the striped stream, owns a transfer thread */
+struct stm32_stripe_link {
+    struct i2c_client *client;
+    struct i2c_adapter *adapter;       /* Own reference, NULL for the primary bus */
+    struct work_struct work;
+    unsigned int index;
+    int ret;
+    unsigned int speed_hz;             /* Controller's clock-frequency */
+    int calib_bus;                     /* Adapter number at last calibration */
+    int calib_errors[ARRAY_SIZE(stm32_calib_speeds)];  /* -1 = not tested */
+    struct task_struct *xfer_task;     /* NULL: transfers run in the caller */
+    struct list_head xfer_queue;
+    spinlock_t xfer_lock;              /* Protects xfer_task and xfer_queue */
+    wait_queue_head_t xfer_wait;
+};
+
+/* A transfer handed to a link's thread; lives on the caller's stack */
+struct stm32_xfer_req {
+    struct list_head node;
+    struct i2c_adapter *adapter;
+    struct i2c_msg *msgs;
+    int num;
+    int ret;
+    struct completion done;
+};
+
+/* One capture record as seen by read() on /dev/i2c_stm32_capture (48 bytes) */
+struct stm32_sample {
+    s64 timestamp_ns;                  /* ktime_get() at start of the read */
+    u8 reg;                            /* First register of the block */
+    u8 len;                            /* Valid bytes in data[] */
+    u8 reserved[6];
+    u8 data[STM32_SAMPLE_MAX_LEN];
+};
 
 static dev_t dev_number;
 static struct class *dev_class;
@@ -24,49 +126,1305 @@ static struct cdev my_cdev;
 static struct i2c_client *stm32_client;
 static struct i2c_adapter *i2c_adapter;
 
-/* Function to write data to STM32 */
-static int stm32_i2c_write(struct i2c_client *client, uint8_t *data, uint8_t len)
+/*
+ * Bus users hold bus_sem for read. Speed changes and calibration hold it
+ * for write: they rebind the controller and replace the clients.
+ */
+static DECLARE_RWSEM(bus_sem);
+
+static struct cdev capture_cdev;
+static struct hrtimer sample_timer;
+static ktime_t sample_period;
+static struct workqueue_struct *sample_wq;
+static struct work_struct sample_work;
+static DEFINE_KFIFO(sample_fifo, struct stm32_sample, STM32_SAMPLE_FIFO_LEN);
+static DECLARE_WAIT_QUEUE_HEAD(sample_wait);
+static DEFINE_MUTEX(sample_lock);          /* Serializes rate changes */
+static DEFINE_MUTEX(capture_read_lock);    /* kfifo has a single consumer */
+static unsigned int sample_rate_hz;
+static u8 sample_reg = STM32_REG_LOOP_COUNT;
+static u8 sample_len = 4;
+static atomic_t sample_overruns = ATOMIC_INIT(0);
+static atomic_t sample_missed = ATOMIC_INIT(0);
+static atomic_t sample_busy = ATOMIC_INIT(0);   /* Set by timer, cleared when the read is done */
+
+static struct work_struct calib_work;
+static DEFINE_MUTEX(calib_lock);
+static bool calibrating;
+static bool shutting_down;                 /* Module exit: no new calibration */
+static int calib_ret;                      /* Result of the last calibration */
+static atomic_t xfer_errors = ATOMIC_INIT(0);
+static unsigned long xfer_err_window;
+
+/* Persist the calibrated speeds with "bus_speed_hz=N,N" at load */
+static unsigned int bus_speed_hz[STM32_STRIPE_MAX_LINKS];
+static int bus_speed_count;
+module_param_array(bus_speed_hz, uint, &bus_speed_count, 0444);
+MODULE_PARM_DESC(bus_speed_hz, "Bus speeds to apply at load in Hz, in stripe_links order (0 = keep device tree value)");
+
+static int stripe_adapters[STM32_STRIPE_MAX_LINKS - 1];
+static int stripe_adapter_count;
+module_param_array(stripe_adapters, int, &stripe_adapter_count, 0444);
+MODULE_PARM_DESC(stripe_adapters, "Extra I2C adapter numbers to stripe across (bus 1 is always used)");
+
+static struct cdev stripe_cdev;
+static struct stm32_stripe_link stripe_links[STM32_STRIPE_MAX_LINKS];
+static unsigned int stripe_nlinks;
+static struct workqueue_struct *stripe_wq;
+static DEFINE_MUTEX(stripe_lock);          /* One striped write at a time */
+static atomic_t stripe_open_count = ATOMIC_INIT(0);
+static u16 stripe_seq;
+static bool stripe_broken;                 /* A chunk was lost, reopen to reset */
+static const u8 *stripe_round_buf;         /* Current round, read by link works */
+static size_t stripe_round_len;
+static u16 stripe_round_seq;
+
+static bool xfer_thread;
+module_param(xfer_thread, bool, 0444);
+MODULE_PARM_DESC(xfer_thread, "Run all transfers on a dedicated kthread per bus");
+
+static int xfer_rt_prio;
+module_param(xfer_rt_prio, int, 0444);
+MODULE_PARM_DESC(xfer_rt_prio, "SCHED_FIFO priority of transfer threads (0 = SCHED_NORMAL)");
+
+static char *xfer_cpus;
+module_param(xfer_cpus, charp, 0444);
+MODULE_PARM_DESC(xfer_cpus, "CPU list for transfer threads, e.g. \"3\" (default: all)");
+
+static struct cpumask xfer_cpumask;
+static DEFINE_MUTEX(xfer_cfg_lock);        /* Serializes thread start/stop/tuning */
+
+static bool auto_recalibrate = true;
+module_param(auto_recalibrate, bool, 0644);
+MODULE_PARM_DESC(auto_recalibrate, "Recalibrate bus speed when transfer errors spike");
+
+/* Count a failed transfer and schedule recalibration when errors spike */
+static void stm32_note_xfer_error(void)
+{
+    if (READ_ONCE(calibrating) || READ_ONCE(shutting_down))
+        return;
+    
+    if (time_after(jiffies, xfer_err_window + msecs_to_jiffies(STM32_ERR_WINDOW_MS))) {
+        xfer_err_window = jiffies;
+        atomic_set(&xfer_errors, 0);
+    }
+    
+    if (atomic_inc_return(&xfer_errors) == STM32_ERR_THRESHOLD &&
+        READ_ONCE(auto_recalibrate)) {
+        pr_warn("%d I2C errors in %d ms, recalibrating bus speed\n",
+                STM32_ERR_THRESHOLD, STM32_ERR_WINDOW_MS);
+        queue_work(system_long_wq, &calib_work);
+    }
+}
+
+/* Find the link whose client sits on an adapter */
+static struct stm32_stripe_link *stm32_link_for(struct i2c_adapter *adap)
+{
+    int i;
+    
+    for (i = 0; i < stripe_nlinks; i++) {
+        if (stripe_links[i].client && stripe_links[i].client->adapter == adap)
+            return &stripe_links[i];
+    }
+    
+    return NULL;
+}
+
+/*
+ * Every transfer goes through here. With a transfer thread running on the
+ * bus the request is queued to it and the caller sleeps on a completion,
+ * so bus timing no longer depends on how the caller is scheduled.
+ */
+static int stm32_xfer(struct i2c_adapter *adap, struct i2c_msg *msgs, int num)
+{
+    struct stm32_stripe_link *link = stm32_link_for(adap);
+    struct stm32_xfer_req req;
+    
+    if (!link)
+        return i2c_transfer(adap, msgs, num);
+    
+    req.adapter = adap;
+    req.msgs = msgs;
+    req.num = num;
+    init_completion(&req.done);
+    
+    spin_lock(&link->xfer_lock);
+    if (!link->xfer_task) {
+        spin_unlock(&link->xfer_lock);
+        return i2c_transfer(adap, msgs, num);
+    }
+    list_add_tail(&req.node, &link->xfer_queue);
+    spin_unlock(&link->xfer_lock);
+    
+    wake_up(&link->xfer_wait);
+    wait_for_completion(&req.done);
+    
+    return req.ret;
+}
+
+/* Take the oldest queued request, or NULL */
+static struct stm32_xfer_req *stm32_xfer_dequeue(struct stm32_stripe_link *link)
+{
+    struct stm32_xfer_req *req;
+    
+    spin_lock(&link->xfer_lock);
+    req = list_first_entry_or_null(&link->xfer_queue, struct stm32_xfer_req, node);
+    if (req)
+        list_del(&req->node);
+    spin_unlock(&link->xfer_lock);
+    
+    return req;
+}
+
+/* Transfer thread - executes queued requests in order */
+static int stm32_xfer_thread_fn(void *data)
+{
+    struct stm32_stripe_link *link = data;
+    struct stm32_xfer_req *req;
+    
+    while (!kthread_should_stop()) {
+        wait_event_interruptible(link->xfer_wait,
+                                 !list_empty(&link->xfer_queue) ||
+                                 kthread_should_stop());
+        
+        while ((req = stm32_xfer_dequeue(link))) {
+            req->ret = i2c_transfer(req->adapter, req->msgs, req->num);
+            complete(&req->done);
+        }
+    }
+    
+    return 0;
+}
+
+/* Apply the configured policy and affinity to a transfer thread */
+static int stm32_xfer_apply_sched(struct task_struct *task)
+{
+    struct sched_attr attr = {
+        .size = sizeof(attr),
+        .sched_policy = xfer_rt_prio ? SCHED_FIFO : SCHED_NORMAL,
+        .sched_priority = xfer_rt_prio,
+    };
+    int ret;
+    
+    ret = sched_setattr_nocheck(task, &attr);
+    if (ret < 0) {
+        pr_err("Failed to set transfer thread priority %d: %d\n", xfer_rt_prio, ret);
+        return ret;
+    }
+    
+    ret = set_cpus_allowed_ptr(task, &xfer_cpumask);
+    if (ret < 0) {
+        pr_err("Failed to set transfer thread affinity: %d\n", ret);
+        return ret;
+    }
+    
+    return 0;
+}
+
+/* Start one transfer thread per link (call with xfer_cfg_lock held) */
+static int stm32_xfer_start(void)
+{
+    struct stm32_stripe_link *link;
+    struct task_struct *task;
+    int i, ret;
+    
+    for (i = 0; i < stripe_nlinks; i++) {
+        link = &stripe_links[i];
+        if (link->xfer_task || !link->client)
+            continue;
+        
+        task = kthread_create(stm32_xfer_thread_fn, link, "i2c_stm32/%d",
+                              i2c_adapter_id(link->client->adapter));
+        if (IS_ERR(task)) {
+            pr_err("Failed to create transfer thread: %ld\n", PTR_ERR(task));
+            return PTR_ERR(task);
+        }
+        
+        /* A thread without the requested policy would be misreported in sysfs */
+        ret = stm32_xfer_apply_sched(task);
+        if (ret < 0) {
+            kthread_stop(task);
+            return ret;
+        }
+        wake_up_process(task);
+        
+        spin_lock(&link->xfer_lock);
+        link->xfer_task = task;
+        spin_unlock(&link->xfer_lock);
+    }
+    
+    xfer_thread = true;
+    pr_info("Transfer threads running (prio %d, cpus %*pbl)\n", xfer_rt_prio,
+            cpumask_pr_args(&xfer_cpumask));
+    return 0;
+}
+
+/* Stop transfer threads; anything still queued runs in the caller (xfer_cfg_lock held) */
+static void stm32_xfer_stop(void)
+{
+    struct stm32_stripe_link *link;
+    struct stm32_xfer_req *req;
+    struct task_struct *task;
+    int i;
+    
+    for (i = 0; i < stripe_nlinks; i++) {
+        link = &stripe_links[i];
+        
+        /* No new requests are queued once xfer_task is NULL */
+        spin_lock(&link->xfer_lock);
+        task = link->xfer_task;
+        link->xfer_task = NULL;
+        spin_unlock(&link->xfer_lock);
+        
+        if (!task)
+            continue;
+        
+        kthread_stop(task);
+        
+        while ((req = stm32_xfer_dequeue(link))) {
+            req->ret = i2c_transfer(req->adapter, req->msgs, req->num);
+            complete(&req->done);
+        }
+    }
+    
+    xfer_thread = false;
+}
+
+/* Function to write data to STM32 */
+static int stm32_i2c_write(struct i2c_client *client, uint8_t *data, uint16_t len)
+{
+    int ret;
+    struct i2c_msg msg;
+    
+    msg.addr = client->addr;
+    msg.flags = 0; /* Write operation */
+    msg.len = len;
+    msg.buf = data;
+    
+    ret = stm32_xfer(client->adapter, &msg, 1);
+    
+    if (ret < 0) {
+        pr_err("I2C write failed: %d\n", ret);
+        stm32_note_xfer_error();
+        return ret;
+    }
+    
+    pr_info("I2C write successful, sent %d bytes\n", len);
+    return 0;
+}
+
+/* Function to read data from STM32 */
+static int stm32_i2c_read(struct i2c_client *client, uint8_t *data, uint16_t len)
+{
+    int ret;
+    struct i2c_msg msg;
+    
+    msg.addr = client->addr;
+    msg.flags = I2C_M_RD; /* Read operation */
+    msg.len = len;
+    msg.buf = data;
+    
+    ret = stm32_xfer(client->adapter, &msg, 1);
+    
+    if (ret < 0) {
+        pr_err("I2C read failed: %d\n", ret);
+        stm32_note_xfer_error();
+        return ret;
+    }
+    
+    pr_info("I2C read successful, received %d bytes\n", len);
+    return 0;
+}
+
+/* Function to read a register block from STM32 (pointer write + repeated start read) */
+static int stm32_i2c_read_block(struct i2c_client *client, uint8_t reg, uint8_t *data, uint8_t len)
+{
+    int ret;
+    struct i2c_msg msgs[2];
+    
+    msgs[0].addr = client->addr;
+    msgs[0].flags = 0; /* Register pointer */
+    msgs[0].len = 1;
+    msgs[0].buf = &reg;
+    
+    msgs[1].addr = client->addr;
+    msgs[1].flags = I2C_M_RD;
+    msgs[1].len = len;
+    msgs[1].buf = data;
+    
+    ret = stm32_xfer(client->adapter, msgs, 2);
+    
+    /* Called at the sampling rate - no log on success */
+    if (ret < 0) {
+        pr_err_ratelimited("I2C block read failed: %d\n", ret);
+        stm32_note_xfer_error();
+        return ret;
+    }
+    if (ret != 2) {
+        stm32_note_xfer_error();
+        return -EIO;
+    }
+    
+    return 0;
+}
+
+/* Function to broadcast data to all slaves on an adapter (general call) */
+static int stm32_i2c_broadcast(struct i2c_adapter *adap, uint8_t *data, uint8_t len)
+{
+    int ret;
+    struct i2c_msg msg;
+    
+    msg.addr = I2C_GENERAL_CALL_ADDR;
+    msg.flags = 0; /* General call is always a write */
+    msg.len = len;
+    msg.buf = data;
+    
+    ret = stm32_xfer(adap, &msg, 1);
+    
+    if (ret < 0) {
+        pr_err("I2C broadcast failed: %d\n", ret);
+        return ret;
+    }
+    
+    pr_info("I2C broadcast successful, sent %d bytes\n", len);
+    return 0;
+}
+
+/* sysfs - broadcast: hex command bytes ("08 05") sent as one general-call write */
+static ssize_t broadcast_store(struct device *dev, struct device_attribute *attr,
+                               const char *buf, size_t count)
+{
+    uint8_t data[STM32_GC_MAX_LEN];
+    char *tokens, *cur, *tok;
+    int len = 0;
+    int ret = 0;
+    
+    tokens = kstrndup(buf, count, GFP_KERNEL);
+    if (!tokens)
+        return -ENOMEM;
+    
+    /* Whitespace separated, so the newline from echo is not sent as 0x0A */
+    cur = tokens;
+    while ((tok = strsep(&cur, " \t\n")) != NULL) {
+        if (*tok == '\0')
+            continue;
+        
+        if (len == STM32_GC_MAX_LEN) {
+            ret = -EINVAL;
+            break;
+        }
+        
+        ret = kstrtou8(tok, 16, &data[len++]);
+        if (ret < 0)
+            break;
+    }
+    kfree(tokens);
+    
+    if (ret < 0)
+        return ret;
+    
+    if (len == 0)
+        return -EINVAL;
+    
+    down_read(&bus_sem);
+    ret = i2c_adapter ? stm32_i2c_broadcast(i2c_adapter, data, len) : -ENODEV;
+    up_read(&bus_sem);
+    if (ret < 0)
+        return ret;
+    
+    return count;
+}
+static DEVICE_ATTR_WO(broadcast);
+
+/* sysfs - sync: single-byte shortcut for the SYNC command */
+static ssize_t sync_store(struct device *dev, struct device_attribute *attr,
+                          const char *buf, size_t count)
+{
+    uint8_t cmd = STM32_GC_CMD_SYNC;
+    int ret;
+    
+    down_read(&bus_sem);
+    ret = i2c_adapter ? stm32_i2c_broadcast(i2c_adapter, &cmd, 1) : -ENODEV;
+    up_read(&bus_sem);
+    if (ret < 0)
+        return ret;
+    
+    return count;
+}
+static DEVICE_ATTR_WO(sync);
+
+/* Sampling work - runs in process context so it may sleep on the bus */
+static void stm32_sample_work(struct work_struct *work)
+{
+    struct stm32_sample sample = { 0 };
+    int ret;
+    
+    down_read(&bus_sem);
+    if (!stm32_client) {
+        up_read(&bus_sem);
+        goto out;
+    }
+    
+    sample.reg = READ_ONCE(sample_reg);
+    sample.len = READ_ONCE(sample_len);
+    sample.timestamp_ns = ktime_to_ns(ktime_get());
+    
+    ret = stm32_i2c_read_block(stm32_client, sample.reg, sample.data, sample.len);
+    up_read(&bus_sem);
+    if (ret < 0)
+        goto out;
+    
+    if (!kfifo_put(&sample_fifo, sample)) {
+        atomic_inc(&sample_overruns);
+        goto out;
+    }
+    
+    wake_up_interruptible(&sample_wait);
+    
+out:
+    atomic_set(&sample_busy, 0);
+}
+
+/* Sampling timer - hard interrupt context, only kicks the work */
+static enum hrtimer_restart stm32_sample_timer(struct hrtimer *timer)
+{
+    /* Previous sample still queued or on the bus - skip this period */
+    if (atomic_xchg(&sample_busy, 1))
+        atomic_inc(&sample_missed);
+    else
+        queue_work(sample_wq, &sample_work);
+    
+    hrtimer_forward_now(timer, sample_period);
+    return HRTIMER_RESTART;
+}
+
+/* Stop sampling and wait for an in-flight read */
+static void stm32_sample_stop(void)
+{
+    hrtimer_cancel(&sample_timer);
+    cancel_work_sync(&sample_work);
+    
+    /* A cancelled work never cleared the flag */
+    atomic_set(&sample_busy, 0);
+}
+
+/* SCL rate a controller was probed with (i2c-bcm2835 defaults to 100 kHz) */
+static unsigned int stm32_adapter_speed(struct i2c_adapter *adap)
+{
+    u32 hz = I2C_MAX_STANDARD_MODE_FREQ;
+    
+    if (adap->dev.parent)
+        of_property_read_u32(adap->dev.parent->of_node, "clock-frequency", &hz);
+    
+    return hz;
+}
+
+#ifdef CONFIG_OF_DYNAMIC
+/* Replace a controller's clock-frequency property in the live tree */
+static int stm32_of_set_speed(struct device_node *np, unsigned int hz)
+{
+    struct of_changeset cs;
+    struct property *prop;
+    __be32 val = cpu_to_be32(hz);
+    int ret;
+    
+    prop = kzalloc(sizeof(*prop), GFP_KERNEL);
+    if (!prop)
+        return -ENOMEM;
+    
+    prop->name = kstrdup("clock-frequency", GFP_KERNEL);
+    prop->value = kmemdup(&val, sizeof(val), GFP_KERNEL);
+    prop->length = sizeof(val);
+    if (!prop->name || !prop->value) {
+        kfree(prop->value);
+        kfree(prop->name);
+        kfree(prop);
+        return -ENOMEM;
+    }
+    
+    /* Once handed to the changeset the node owns prop, even on failure */
+    of_changeset_init(&cs);
+    ret = of_changeset_update_property(&cs, np, prop);
+    if (ret == 0)
+        ret = of_changeset_apply(&cs);
+    of_changeset_destroy(&cs);
+    
+    return ret;
+}
+#else
+static int stm32_of_set_speed(struct device_node *np, unsigned int hz)
+{
+    return -EOPNOTSUPP;
+}
+#endif
+
+/*
+ * i2c-bcm2835 holds its SCL divider with clk_set_rate_exclusive() and only
+ * reads clock-frequency in probe, so a new speed means updating the property
+ * and rebinding the controller. The link gets a new adapter and client.
+ * Call with bus_sem held for write and transfer threads stopped.
+ */
+static int stm32_link_set_speed(struct stm32_stripe_link *link, unsigned int hz)
+{
+    struct i2c_board_info board_info = {
+        I2C_BOARD_INFO("stm32_slave", STM32_I2C_ADDR)
+    };
+    struct i2c_adapter *adap;
+    struct i2c_client *client;
+    struct device *parent;
+    struct device_node *np;
+    int ret;
+    
+    if (!link->client)
+        return -ENODEV;
+    
+    parent = link->client->adapter->dev.parent;
+    if (!parent || !parent->of_node)
+        return -EOPNOTSUPP;
+    
+    get_device(parent);
+    np = of_node_get(parent->of_node);
+    
+    ret = stm32_of_set_speed(np, hz);
+    if (ret < 0) {
+        pr_err("Failed to set clock-frequency %u on i2c-%d: %d\n", hz,
+               i2c_adapter_id(link->client->adapter), ret);
+        goto out;
+    }
+    
+    /* Unbinding waits for every adapter reference, ours included */
+    adap = link->client->adapter;
+    i2c_unregister_device(link->client);
+    i2c_put_adapter(adap);
+    link->client = NULL;
+    link->adapter = NULL;
+    if (link == &stripe_links[0]) {
+        stm32_client = NULL;
+        i2c_adapter = NULL;
+    }
+    
+    device_release_driver(parent);
+    ret = device_attach(parent);
+    if (ret <= 0) {
+        pr_err("Failed to rebind %s: %d\n", dev_name(parent), ret);
+        ret = ret < 0 ? ret : -ENODEV;
+        goto out;
+    }
+    
+    adap = of_get_i2c_adapter_by_node(np);
+    if (!adap) {
+        pr_err("No adapter on %s after rebind\n", dev_name(parent));
+        ret = -ENODEV;
+        goto out;
+    }
+    
+    client = i2c_new_client_device(adap, &board_info);
+    if (IS_ERR(client)) {
+        pr_err("Failed to recreate client on i2c-%d\n", i2c_adapter_id(adap));
+        i2c_put_adapter(adap);
+        ret = PTR_ERR(client);
+        goto out;
+    }
+    
+    link->client = client;
+    link->speed_hz = hz;
+    if (link == &stripe_links[0]) {
+        stm32_client = client;
+        i2c_adapter = adap;
+    } else {
+        link->adapter = adap;
+    }
+    ret = 0;
+    
+out:
+    of_node_put(np);
+    put_device(parent);
+    return ret;
+}
+
+/* Change a link's bus speed - bus_sem held for write */
+static int stm32_set_bus_speed(struct stm32_stripe_link *link, unsigned int hz)
+{
+    bool threads;
+    int ret;
+    
+    if (link->client && link->speed_hz == hz)
+        return 0;
+    
+    /* Threads are bound to the old adapter */
+    mutex_lock(&xfer_cfg_lock);
+    threads = xfer_thread;
+    stm32_xfer_stop();
+    
+    ret = stm32_link_set_speed(link, hz);
+    
+    if (threads && stm32_xfer_start() < 0)
+        stm32_xfer_stop();
+    mutex_unlock(&xfer_cfg_lock);
+    
+    if (ret < 0)
+        return ret;
+    
+    pr_info("Bus speed set to %u Hz on i2c-%d\n", hz,
+            i2c_adapter_id(link->client->adapter));
+    return 0;
+}
+
+/* Write a random pattern to the scratch block and read it back */
+static int stm32_calib_loopback(struct i2c_client *client)
+{
+    uint8_t tx[STM32_CALIB_LEN + 1];
+    uint8_t rx[STM32_CALIB_LEN];
+    struct i2c_msg msg;
+    int ret;
+    
+    tx[0] = STM32_CALIB_REG;
+    get_random_bytes(&tx[1], STM32_CALIB_LEN);
+    
+    msg.addr = client->addr;
+    msg.flags = 0;
+    msg.len = sizeof(tx);
+    msg.buf = tx;
+    
+    ret = stm32_xfer(client->adapter, &msg, 1);
+    if (ret != 1)
+        return ret < 0 ? ret : -EIO;
+    
+    ret = stm32_i2c_read_block(client, STM32_CALIB_REG, rx, STM32_CALIB_LEN);
+    if (ret < 0)
+        return ret;
+    
+    if (memcmp(&tx[1], rx, STM32_CALIB_LEN))
+        return -EIO;
+    
+    return 0;
+}
+
+/*
+ * Step one link through the candidate speeds, slowest first, and keep the
+ * fastest one that passes every loopback round. Stops at the first speed
+ * that fails. Call with bus_sem held for write.
+ */
+static int stm32_calibrate_link(struct stm32_stripe_link *link)
+{
+    unsigned int best = 0, prev = link->speed_hz;
+    int i, round, err;
+    int ret = 0;
+    
+    for (i = 0; i < ARRAY_SIZE(stm32_calib_speeds); i++)
+        link->calib_errors[i] = -1;
+    
+    if (!link->client)
+        return -ENODEV;
+    
+    link->calib_bus = i2c_adapter_id(link->client->adapter);
+    
+    for (i = 0; i < ARRAY_SIZE(stm32_calib_speeds); i++) {
+        ret = stm32_set_bus_speed(link, stm32_calib_speeds[i]);
+        if (ret < 0) {
+            pr_err("Calibration: i2c-%d cannot switch to %u Hz: %d\n",
+                   link->calib_bus, stm32_calib_speeds[i], ret);
+            break;
+        }
+        
+        link->calib_errors[i] = 0;
+        for (round = 0; round < STM32_CALIB_ROUNDS; round++) {
+            if (stm32_calib_loopback(link->client) < 0)
+                link->calib_errors[i]++;
+        }
+        
+        pr_info("Calibration: i2c-%d %u Hz, %d/%d errors\n", link->calib_bus,
+                stm32_calib_speeds[i], link->calib_errors[i], STM32_CALIB_ROUNDS);
+        
+        if (link->calib_errors[i])
+            break;
+        best = stm32_calib_speeds[i];
+    }
+    
+    if (ret < 0) {
+        /* Sweep cut short - keep the last good speed, or the one we had */
+        if (!best)
+            best = prev;
+    } else if (!best) {
+        pr_warn("Calibration: no reliable speed on i2c-%d, falling back to %u Hz\n",
+                link->calib_bus, stm32_calib_speeds[0]);
+        best = stm32_calib_speeds[0];
+        ret = -EIO;
+    }
+    
+    err = stm32_set_bus_speed(link, best);
+    return ret < 0 ? ret : err;
+}
+
+/* Calibrate every link on its own wiring; returns the first failure */
+static int stm32_calibrate(void)
+{
+    int i, err;
+    int ret = 0;
+    
+    mutex_lock(&calib_lock);
+    
+    if (READ_ONCE(shutting_down)) {
+        mutex_unlock(&calib_lock);
+        return -ESHUTDOWN;
+    }
+    
+    /*
+     * Untested speeds must not carry real traffic: stop sampling (its work
+     * would block on bus_sem) and hold every other bus user off the sweep.
+     */
+    mutex_lock(&sample_lock);
+    stm32_sample_stop();
+    down_write(&bus_sem);
+    WRITE_ONCE(calibrating, true);
+    
+    for (i = 0; i < stripe_nlinks; i++) {
+        err = stm32_calibrate_link(&stripe_links[i]);
+        if (err < 0 && ret == 0)
+            ret = err;
+    }
+    
+    atomic_set(&xfer_errors, 0);
+    WRITE_ONCE(calibrating, false);
+    calib_ret = ret;
+    up_write(&bus_sem);
+    
+    if (sample_rate_hz)
+        hrtimer_start(&sample_timer, sample_period, HRTIMER_MODE_REL);
+    mutex_unlock(&sample_lock);
+    mutex_unlock(&calib_lock);
+    
+    return ret;
+}
+
+/* Background recalibration after an error spike */
+static void stm32_calib_work(struct work_struct *work)
+{
+    stm32_calibrate();
+}
+
+/* sysfs - sample_rate_hz: 0 stops capture, otherwise (re)starts it */
+static ssize_t sample_rate_hz_show(struct device *dev, struct device_attribute *attr,
+                                   char *buf)
+{
+    return sysfs_emit(buf, "%u\n", sample_rate_hz);
+}
+
+static ssize_t sample_rate_hz_store(struct device *dev, struct device_attribute *attr,
+                                    const char *buf, size_t count)
+{
+    unsigned int rate;
+    int ret;
+    
+    ret = kstrtouint(buf, 0, &rate);
+    if (ret < 0)
+        return ret;
+    
+    if (rate > STM32_SAMPLE_MAX_HZ)
+        return -EINVAL;
+    
+    mutex_lock(&sample_lock);
+    stm32_sample_stop();
+    sample_rate_hz = rate;
+    if (rate) {
+        sample_period = ns_to_ktime(div_u64(NSEC_PER_SEC, rate));
+        hrtimer_start(&sample_timer, sample_period, HRTIMER_MODE_REL);
+        pr_info("Sampling 0x%02x+%u at %u Hz\n", sample_reg, sample_len, rate);
+    } else {
+        pr_info("Sampling stopped\n");
+    }
+    mutex_unlock(&sample_lock);
+    
+    return count;
+}
+static DEVICE_ATTR_RW(sample_rate_hz);
+
+/* sysfs - sample_reg: first register of the sampled block */
+static ssize_t sample_reg_show(struct device *dev, struct device_attribute *attr,
+                               char *buf)
+{
+    return sysfs_emit(buf, "0x%02x\n", sample_reg);
+}
+
+static ssize_t sample_reg_store(struct device *dev, struct device_attribute *attr,
+                                const char *buf, size_t count)
+{
+    u8 reg;
+    int ret;
+    
+    ret = kstrtou8(buf, 0, &reg);
+    if (ret < 0)
+        return ret;
+    
+    WRITE_ONCE(sample_reg, reg);
+    return count;
+}
+static DEVICE_ATTR_RW(sample_reg);
+
+/* sysfs - sample_len: bytes per sample (1..STM32_SAMPLE_MAX_LEN) */
+static ssize_t sample_len_show(struct device *dev, struct device_attribute *attr,
+                               char *buf)
+{
+    return sysfs_emit(buf, "%u\n", sample_len);
+}
+
+static ssize_t sample_len_store(struct device *dev, struct device_attribute *attr,
+                                const char *buf, size_t count)
+{
+    u8 len;
+    int ret;
+    
+    ret = kstrtou8(buf, 0, &len);
+    if (ret < 0)
+        return ret;
+    
+    if (len == 0 || len > STM32_SAMPLE_MAX_LEN)
+        return -EINVAL;
+    
+    WRITE_ONCE(sample_len, len);
+    return count;
+}
+static DEVICE_ATTR_RW(sample_len);
+
+/* sysfs - sample_overruns: samples dropped because the buffer was full */
+static ssize_t sample_overruns_show(struct device *dev, struct device_attribute *attr,
+                                    char *buf)
+{
+    return sysfs_emit(buf, "%d\n", atomic_read(&sample_overruns));
+}
+static DEVICE_ATTR_RO(sample_overruns);
+
+/* sysfs - sample_missed: periods skipped because the bus was still busy */
+static ssize_t sample_missed_show(struct device *dev, struct device_attribute *attr,
+                                  char *buf)
 {
-    int ret;
+    return sysfs_emit(buf, "%d\n", atomic_read(&sample_missed));
+}
+static DEVICE_ATTR_RO(sample_missed);
+
+/* Send one chunk frame on a link */
+static int stm32_stripe_send_chunk(struct stm32_stripe_link *link, u16 seq,
+                                   const u8 *data, u8 len)
+{
+    u8 frame[1 + STM32_STRIPE_HDR_LEN + STM32_STRIPE_CHUNK_MAX];
     struct i2c_msg msg;
+    int attempt;
+    int ret = 0;
     
-    msg.addr = client->addr;
-    msg.flags = 0; /* Write operation */
-    msg.len = len;
-    msg.buf = data;
+    frame[0] = STM32_REG_STRIPE;
+    frame[1] = seq & 0xFF;
+    frame[2] = seq >> 8;
+    frame[3] = len;
+    memcpy(&frame[4], data, len);
     
-    ret = i2c_transfer(client->adapter, &msg, 1);
+    msg.addr = link->client->addr;
+    msg.flags = 0;
+    msg.len = 1 + STM32_STRIPE_HDR_LEN + len;
+    msg.buf = frame;
     
-    if (ret < 0) {
-        pr_err("I2C write failed: %d\n", ret);
+    for (attempt = 0; attempt < STM32_STRIPE_RETRIES; attempt++) {
+        ret = stm32_xfer(link->client->adapter, &msg, 1);
+        if (ret == 1)
+            return 0;
+    }
+    
+    pr_err_ratelimited("Stripe chunk %u failed on i2c-%d: %d\n", seq,
+                       i2c_adapter_id(link->client->adapter), ret);
+    return ret < 0 ? ret : -EIO;
+}
+
+/* Link work - sends every nlinks-th chunk of the current round */
+static void stm32_stripe_link_work(struct work_struct *work)
+{
+    struct stm32_stripe_link *link = container_of(work, struct stm32_stripe_link, work);
+    size_t step = stripe_nlinks * STM32_STRIPE_CHUNK_MAX;
+    size_t off = link->index * STM32_STRIPE_CHUNK_MAX;
+    u16 seq = stripe_round_seq + link->index;
+    
+    link->ret = 0;
+    
+    for (; off < stripe_round_len; off += step, seq += stripe_nlinks) {
+        link->ret = stm32_stripe_send_chunk(link, seq, stripe_round_buf + off,
+                                            min_t(size_t, STM32_STRIPE_CHUNK_MAX,
+                                                  stripe_round_len - off));
+        if (link->ret < 0)
+            return;
+    }
+}
+
+/*
+ * Check the firmware consumed every chunk of the round. A chunk can be
+ * ACKed and still dropped (window full, slot busy), so resend anything
+ * from the firmware's next expected seq onwards; duplicates are dropped.
+ */
+static int stm32_stripe_verify(unsigned int nchunks)
+{
+    u16 expected = stripe_round_seq + nchunks;
+    u16 fw_seq, seq;
+    u8 raw[2];
+    size_t off;
+    int attempt;
+    int ret;
+    
+    for (attempt = 0; ; attempt++) {
+        ret = stm32_i2c_read_block(stm32_client, STM32_REG_STRIPE_SEQ, raw, sizeof(raw));
+        if (ret < 0)
+            return ret;
+        
+        fw_seq = raw[0] | (raw[1] << 8);
+        if (fw_seq == expected)
+            return 0;
+        
+        /* Outside this round - the firmware was reset under us */
+        if ((u16)(fw_seq - stripe_round_seq) > nchunks) {
+            pr_err("Stripe seq %u outside round %u..%u\n", fw_seq,
+                   stripe_round_seq, expected);
+            return -EIO;
+        }
+        
+        if (attempt == STM32_STRIPE_RETRIES)
+            break;
+        
+        for (seq = fw_seq; seq != expected; seq++) {
+            unsigned int idx = (u16)(seq - stripe_round_seq);
+            
+            off = idx * STM32_STRIPE_CHUNK_MAX;
+            ret = stm32_stripe_send_chunk(&stripe_links[idx % stripe_nlinks], seq,
+                                          stripe_round_buf + off,
+                                          min_t(size_t, STM32_STRIPE_CHUNK_MAX,
+                                                stripe_round_len - off));
+            if (ret < 0)
+                return ret;
+        }
+    }
+    
+    pr_err("Stripe stalled at seq %u, expected %u\n", fw_seq, expected);
+    return -EIO;
+}
+
+/* Bind the primary client and any extra adapters as stripe links */
+static void stm32_stripe_setup(struct i2c_board_info *board_info)
+{
+    struct stm32_stripe_link *link;
+    struct i2c_adapter *adap;
+    struct i2c_client *client;
+    int i, j;
+    
+    stripe_links[0].client = stm32_client;
+    stripe_nlinks = 1;
+    
+    for (i = 0; i < stripe_adapter_count; i++) {
+        adap = i2c_get_adapter(stripe_adapters[i]);
+        if (!adap) {
+            pr_warn("Stripe adapter i2c-%d not found, skipping\n", stripe_adapters[i]);
+            continue;
+        }
+        
+        client = i2c_new_client_device(adap, board_info);
+        if (IS_ERR(client)) {
+            pr_warn("Failed to create stripe client on i2c-%d\n", stripe_adapters[i]);
+            i2c_put_adapter(adap);
+            continue;
+        }
+        
+        link = &stripe_links[stripe_nlinks++];
+        link->adapter = adap;
+        link->client = client;
+    }
+    
+    for (i = 0; i < stripe_nlinks; i++) {
+        link = &stripe_links[i];
+        link->index = i;
+        link->speed_hz = stm32_adapter_speed(link->client->adapter);
+        link->calib_bus = i2c_adapter_id(link->client->adapter);
+        for (j = 0; j < ARRAY_SIZE(stm32_calib_speeds); j++)
+            link->calib_errors[j] = -1;
+        INIT_WORK(&link->work, stm32_stripe_link_work);
+        INIT_LIST_HEAD(&link->xfer_queue);
+        spin_lock_init(&link->xfer_lock);
+        init_waitqueue_head(&link->xfer_wait);
+    }
+    
+    pr_info("Striping across %u bus(es)\n", stripe_nlinks);
+}
+
+/* Release extra stripe links (the primary client is owned elsewhere) */
+static void stm32_stripe_teardown(void)
+{
+    int i;
+    
+    for (i = 1; i < stripe_nlinks; i++) {
+        i2c_unregister_device(stripe_links[i].client);
+        i2c_put_adapter(stripe_links[i].adapter);
+    }
+    stripe_nlinks = 0;
+}
+
+/* sysfs - stripe_links: adapter numbers carrying the striped stream */
+static ssize_t stripe_links_show(struct device *dev, struct device_attribute *attr,
+                                 char *buf)
+{
+    int i, len = 0;
+    
+    down_read(&bus_sem);
+    for (i = 0; i < stripe_nlinks; i++) {
+        if (stripe_links[i].client)
+            len += sysfs_emit_at(buf, len, "%s%d", len ? " " : "",
+                                 i2c_adapter_id(stripe_links[i].client->adapter));
+    }
+    up_read(&bus_sem);
+    len += sysfs_emit_at(buf, len, "\n");
+    
+    return len;
+}
+static DEVICE_ATTR_RO(stripe_links);
+
+/* sysfs - xfer_thread: 1 runs transfers on per-bus kthreads, 0 in the caller */
+static ssize_t xfer_thread_show(struct device *dev, struct device_attribute *attr,
+                                char *buf)
+{
+    return sysfs_emit(buf, "%d\n", xfer_thread);
+}
+
+static ssize_t xfer_thread_store(struct device *dev, struct device_attribute *attr,
+                                 const char *buf, size_t count)
+{
+    bool enable;
+    int ret;
+    
+    ret = kstrtobool(buf, &enable);
+    if (ret < 0)
         return ret;
+    
+    mutex_lock(&xfer_cfg_lock);
+    if (enable) {
+        ret = stm32_xfer_start();
+        if (ret < 0)
+            stm32_xfer_stop();
+    } else {
+        stm32_xfer_stop();
+    }
+    mutex_unlock(&xfer_cfg_lock);
+    
+    return ret < 0 ? ret : count;
+}
+static DEVICE_ATTR_RW(xfer_thread);
+
+/* Re-apply policy and affinity to running threads (xfer_cfg_lock held) */
+static int stm32_xfer_retune(void)
+{
+    int i, ret;
+    
+    for (i = 0; i < stripe_nlinks; i++) {
+        if (!stripe_links[i].xfer_task)
+            continue;
+        
+        ret = stm32_xfer_apply_sched(stripe_links[i].xfer_task);
+        if (ret < 0)
+            return ret;
     }
     
-    pr_info("I2C write successful, sent %d bytes\n", len);
     return 0;
 }
 
-/* Function to read data from STM32 */
-static int stm32_i2c_read(struct i2c_client *client, uint8_t *data, uint8_t len)
+/* sysfs - xfer_rt_prio: SCHED_FIFO priority 1-99, 0 for SCHED_NORMAL */
+static ssize_t xfer_rt_prio_show(struct device *dev, struct device_attribute *attr,
+                                 char *buf)
 {
+    return sysfs_emit(buf, "%d\n", xfer_rt_prio);
+}
+
+static ssize_t xfer_rt_prio_store(struct device *dev, struct device_attribute *attr,
+                                  const char *buf, size_t count)
+{
+    int prio, old;
     int ret;
-    struct i2c_msg msg;
     
-    msg.addr = client->addr;
-    msg.flags = I2C_M_RD; /* Read operation */
-    msg.len = len;
-    msg.buf = data;
+    ret = kstrtoint(buf, 0, &prio);
+    if (ret < 0)
+        return ret;
     
-    ret = i2c_transfer(client->adapter, &msg, 1);
+    if (prio < 0 || prio >= MAX_RT_PRIO)
+        return -EINVAL;
     
+    mutex_lock(&xfer_cfg_lock);
+    old = xfer_rt_prio;
+    xfer_rt_prio = prio;
+    ret = stm32_xfer_retune();
     if (ret < 0) {
-        pr_err("I2C read failed: %d\n", ret);
+        /* Keep reporting what the threads actually run with */
+        xfer_rt_prio = old;
+        stm32_xfer_retune();
+    }
+    mutex_unlock(&xfer_cfg_lock);
+    
+    return ret < 0 ? ret : count;
+}
+static DEVICE_ATTR_RW(xfer_rt_prio);
+
+/* sysfs - xfer_cpus: CPU list the transfer threads may run on */
+static ssize_t xfer_cpus_show(struct device *dev, struct device_attribute *attr,
+                              char *buf)
+{
+    return sysfs_emit(buf, "%*pbl\n", cpumask_pr_args(&xfer_cpumask));
+}
+
+static ssize_t xfer_cpus_store(struct device *dev, struct device_attribute *attr,
+                               const char *buf, size_t count)
+{
+    struct cpumask mask, old;
+    int ret;
+    
+    ret = cpulist_parse(buf, &mask);
+    if (ret < 0)
         return ret;
+    
+    if (!cpumask_subset(&mask, cpu_online_mask) || cpumask_empty(&mask))
+        return -EINVAL;
+    
+    mutex_lock(&xfer_cfg_lock);
+    cpumask_copy(&old, &xfer_cpumask);
+    cpumask_copy(&xfer_cpumask, &mask);
+    ret = stm32_xfer_retune();
+    if (ret < 0) {
+        cpumask_copy(&xfer_cpumask, &old);
+        stm32_xfer_retune();
     }
+    mutex_unlock(&xfer_cfg_lock);
     
-    pr_info("I2C read successful, received %d bytes\n", len);
-    return 0;
+    return ret < 0 ? ret : count;
+}
+static DEVICE_ATTR_RW(xfer_cpus);
+
+/* sysfs - bus_speed_hz: speed per link in stripe_links order, write to force them */
+static ssize_t bus_speed_hz_show(struct device *dev, struct device_attribute *attr,
+                                 char *buf)
+{
+    int i, len = 0;
+    
+    down_read(&bus_sem);
+    for (i = 0; i < stripe_nlinks; i++) {
+        if (stripe_links[i].client)
+            len += sysfs_emit_at(buf, len, "%s%u", len ? " " : "",
+                                 stripe_links[i].speed_hz);
+    }
+    up_read(&bus_sem);
+    len += sysfs_emit_at(buf, len, "\n");
+    
+    return len;
+}
+
+static ssize_t bus_speed_hz_store(struct device *dev, struct device_attribute *attr,
+                                  const char *buf, size_t count)
+{
+    unsigned int hz[STM32_STRIPE_MAX_LINKS];
+    char *tokens, *cur, *tok;
+    int i, n = 0;
+    int ret = 0;
+    
+    tokens = kstrndup(buf, count, GFP_KERNEL);
+    if (!tokens)
+        return -ENOMEM;
+    
+    /* One value sets every link, a list sets them in order */
+    cur = tokens;
+    while ((tok = strsep(&cur, " \t\n")) != NULL) {
+        if (*tok == '\0')
+            continue;
+        
+        if (n == STM32_STRIPE_MAX_LINKS) {
+            ret = -EINVAL;
+            break;
+        }
+        
+        ret = kstrtouint(tok, 0, &hz[n]);
+        if (ret < 0)
+            break;
+        if (hz[n++] == 0) {
+            ret = -EINVAL;
+            break;
+        }
+    }
+    kfree(tokens);
+    
+    if (ret < 0)
+        return ret;
+    
+    if (n == 0)
+        return -EINVAL;
+    
+    mutex_lock(&calib_lock);
+    down_write(&bus_sem);
+    for (i = 0; i < stripe_nlinks && ret == 0; i++) {
+        if (n == 1)
+            ret = stm32_set_bus_speed(&stripe_links[i], hz[0]);
+        else if (i < n)
+            ret = stm32_set_bus_speed(&stripe_links[i], hz[i]);
+    }
+    up_write(&bus_sem);
+    mutex_unlock(&calib_lock);
+    
+    return ret < 0 ? ret : count;
+}
+static DEVICE_ATTR_RW(bus_speed_hz);
+
+/* sysfs - calibrate: any write runs calibration and waits for the result */
+static ssize_t calibrate_store(struct device *dev, struct device_attribute *attr,
+                               const char *buf, size_t count)
+{
+    int ret;
+    
+    ret = stm32_calibrate();
+    return ret < 0 ? ret : count;
+}
+static DEVICE_ATTR_WO(calibrate);
+
+/* sysfs - calib_results: "<bus> <speed> <errors>/<rounds>" per link and speed, then any error */
+static ssize_t calib_results_show(struct device *dev, struct device_attribute *attr,
+                                  char *buf)
+{
+    struct stm32_stripe_link *link;
+    int i, j, len = 0;
+    
+    mutex_lock(&calib_lock);
+    for (i = 0; i < stripe_nlinks; i++) {
+        link = &stripe_links[i];
+        for (j = 0; j < ARRAY_SIZE(stm32_calib_speeds); j++) {
+            if (link->calib_errors[j] < 0)
+                len += sysfs_emit_at(buf, len, "%d %u untested\n", link->calib_bus,
+                                     stm32_calib_speeds[j]);
+            else
+                len += sysfs_emit_at(buf, len, "%d %u %d/%d\n", link->calib_bus,
+                                     stm32_calib_speeds[j], link->calib_errors[j],
+                                     STM32_CALIB_ROUNDS);
+        }
+    }
+    if (calib_ret < 0)
+        len += sysfs_emit_at(buf, len, "error %d\n", calib_ret);
+    mutex_unlock(&calib_lock);
+    
+    return len;
 }
+static DEVICE_ATTR_RO(calib_results);
+
+static struct attribute *stm32_attrs[] = {
+    &dev_attr_broadcast.attr,
+    &dev_attr_sync.attr,
+    &dev_attr_sample_rate_hz.attr,
+    &dev_attr_sample_reg.attr,
+    &dev_attr_sample_len.attr,
+    &dev_attr_sample_overruns.attr,
+    &dev_attr_sample_missed.attr,
+    &dev_attr_bus_speed_hz.attr,
+    &dev_attr_calibrate.attr,
+    &dev_attr_calib_results.attr,
+    &dev_attr_stripe_links.attr,
+    &dev_attr_xfer_thread.attr,
+    &dev_attr_xfer_rt_prio.attr,
+    &dev_attr_xfer_cpus.attr,
+    NULL,
+};
+ATTRIBUTE_GROUPS(stm32);
 
 /* File operations - open */
 static int my_open(struct inode *inode, struct file *file)
@@ -82,58 +1440,88 @@ static int my_release(struct inode *inode, struct file *file)
     return 0;
 }
 
-/* File operations - read */
-static ssize_t my_read(struct file *file, char __user *buf, size_t len, loff_t *off)
+/*
+ * File operations - read_iter
+ * One I2C read scattered into all iovec segments (read, readv, io_uring, AIO)
+ */
+static ssize_t my_read_iter(struct kiocb *iocb, struct iov_iter *to)
 {
-    uint8_t data[256];
+    uint8_t data[STM32_MAX_XFER];
+    size_t len = iov_iter_count(to);
+    size_t copied;
     int ret;
     
-    if (len > 256)
-        len = 256;
+    if (len > STM32_MAX_XFER)
+        len = STM32_MAX_XFER;
     
+    if (len == 0)
+        return 0;
+    
+    /* i2c_transfer() sleeps on the bus - let io_uring punt to a worker */
+    if (iocb->ki_flags & IOCB_NOWAIT)
+        return -EAGAIN;
+    
+    down_read(&bus_sem);
     if (!stm32_client) {
+        up_read(&bus_sem);
         pr_err("I2C client not initialized\n");
         return -ENODEV;
     }
     
     ret = stm32_i2c_read(stm32_client, data, len);
+    up_read(&bus_sem);
     if (ret < 0)
         return ret;
     
-    if (copy_to_user(buf, data, len)) {
+    /* Bytes are already off the bus, so report a partial copy as such */
+    copied = copy_to_iter(data, len, to);
+    if (copied == 0) {
         pr_err("Failed to copy data to user space\n");
         return -EFAULT;
     }
     
-    pr_info("Read %zu bytes from STM32\n", len);
-    return len;
+    pr_info("Read %zu bytes from STM32\n", copied);
+    return copied;
 }
 
-/* File operations - write */
-static ssize_t my_write(struct file *file, const char __user *buf, size_t len, loff_t *off)
+/*
+ * File operations - write_iter
+ * All iovec segments gathered into one I2C write (write, writev, io_uring, AIO)
+ */
+static ssize_t my_write_iter(struct kiocb *iocb, struct iov_iter *from)
 {
     uint8_t *data;
+    size_t len = iov_iter_count(from);
     int ret;
     
-    if (len > 256)
-        len = 256;
+    if (len > STM32_MAX_XFER)
+        len = STM32_MAX_XFER;
     
-    if (!stm32_client) {
-        pr_err("I2C client not initialized\n");
-        return -ENODEV;
-    }
+    if (len == 0)
+        return 0;
+    
+    /* i2c_transfer() sleeps on the bus - let io_uring punt to a worker */
+    if (iocb->ki_flags & IOCB_NOWAIT)
+        return -EAGAIN;
     
     data = kmalloc(len, GFP_KERNEL);
     if (!data)
         return -ENOMEM;
     
-    if (copy_from_user(data, buf, len)) {
+    if (!copy_from_iter_full(data, len, from)) {
         pr_err("Failed to copy data from user space\n");
         kfree(data);
         return -EFAULT;
     }
     
-    ret = stm32_i2c_write(stm32_client, data, len);
+    down_read(&bus_sem);
+    if (stm32_client) {
+        ret = stm32_i2c_write(stm32_client, data, len);
+    } else {
+        pr_err("I2C client not initialized\n");
+        ret = -ENODEV;
+    }
+    up_read(&bus_sem);
     kfree(data);
     
     if (ret < 0)
@@ -148,19 +1536,215 @@ static struct file_operations fops = {
     .owner = THIS_MODULE,
     .open = my_open,
     .release = my_release,
-    .read = my_read,
-    .write = my_write,
+    .read_iter = my_read_iter,
+    .write_iter = my_write_iter,
+};
+
+/* Capture device - read: whole stm32_sample records, blocks until one is ready */
+static ssize_t capture_read(struct file *file, char __user *buf, size_t len, loff_t *off)
+{
+    struct stm32_sample sample;
+    size_t copied = 0;
+    int ret;
+    
+    if (len < sizeof(sample))
+        return -EINVAL;
+    
+    if (mutex_lock_interruptible(&capture_read_lock))
+        return -ERESTARTSYS;
+    
+    while (kfifo_is_empty(&sample_fifo)) {
+        mutex_unlock(&capture_read_lock);
+        
+        if (file->f_flags & O_NONBLOCK)
+            return -EAGAIN;
+        
+        ret = wait_event_interruptible(sample_wait, !kfifo_is_empty(&sample_fifo));
+        if (ret)
+            return ret;
+        
+        if (mutex_lock_interruptible(&capture_read_lock))
+            return -ERESTARTSYS;
+    }
+    
+    while (len - copied >= sizeof(sample) && kfifo_get(&sample_fifo, &sample)) {
+        if (copy_to_user(buf + copied, &sample, sizeof(sample))) {
+            mutex_unlock(&capture_read_lock);
+            return copied ? copied : -EFAULT;
+        }
+        copied += sizeof(sample);
+    }
+    
+    mutex_unlock(&capture_read_lock);
+    return copied;
+}
+
+/* Capture device - poll */
+static __poll_t capture_poll(struct file *file, poll_table *wait)
+{
+    poll_wait(file, &sample_wait, wait);
+    
+    if (!kfifo_is_empty(&sample_fifo))
+        return EPOLLIN | EPOLLRDNORM;
+    
+    return 0;
+}
+
+/* Capture file operations structure */
+static struct file_operations capture_fops = {
+    .owner = THIS_MODULE,
+    .read = capture_read,
+    .poll = capture_poll,
+    .llseek = no_llseek,
+};
+
+/* Stripe device - open: single writer, restarts firmware reassembly */
+static int stripe_open(struct inode *inode, struct file *file)
+{
+    u8 reset = STM32_REG_STRIPE_RESET;
+    int ret;
+    
+    if (!stripe_nlinks)
+        return -ENODEV;
+    
+    if (atomic_cmpxchg(&stripe_open_count, 0, 1))
+        return -EBUSY;
+    
+    mutex_lock(&stripe_lock);
+    down_read(&bus_sem);
+    ret = stm32_client ? stm32_i2c_write(stm32_client, &reset, 1) : -ENODEV;
+    up_read(&bus_sem);
+    stripe_seq = 0;
+    stripe_broken = false;
+    mutex_unlock(&stripe_lock);
+    
+    if (ret < 0) {
+        atomic_set(&stripe_open_count, 0);
+        return ret;
+    }
+    
+    return nonseekable_open(inode, file);
+}
+
+/* Stripe device - close */
+static int stripe_release(struct inode *inode, struct file *file)
+{
+    atomic_set(&stripe_open_count, 0);
+    return 0;
+}
+
+/*
+ * Stripe device - write_iter
+ * Data is cut into chunks numbered by seq and dealt round-robin to the links.
+ * Links run in parallel one round at a time; a round never exceeds the
+ * firmware reassembly window so chunks can always be placed in order,
+ * and its progress is checked before the next round starts.
+ */
+static ssize_t stripe_write_iter(struct kiocb *iocb, struct iov_iter *from)
+{
+    size_t len = min_t(size_t, iov_iter_count(from), STM32_STRIPE_MAX_WRITE);
+    size_t off, round_len;
+    unsigned int i;
+    u8 *data;
+    int ret = 0;
+    
+    if (len == 0)
+        return 0;
+    
+    if (iocb->ki_flags & IOCB_NOWAIT)
+        return -EAGAIN;
+    
+    data = kmalloc(len, GFP_KERNEL);
+    if (!data)
+        return -ENOMEM;
+    
+    if (!copy_from_iter_full(data, len, from)) {
+        kfree(data);
+        return -EFAULT;
+    }
+    
+    mutex_lock(&stripe_lock);
+    down_read(&bus_sem);
+    
+    if (stripe_broken) {
+        ret = -EIO;
+        goto out;
+    }
+    
+    /* A failed speed change leaves a link without a client */
+    for (i = 0; i < stripe_nlinks; i++) {
+        if (!stripe_links[i].client) {
+            ret = -ENODEV;
+            goto out;
+        }
+    }
+    
+    for (off = 0; off < len; off += round_len) {
+        round_len = min_t(size_t, len - off,
+                          STM32_STRIPE_WINDOW * STM32_STRIPE_CHUNK_MAX);
+        
+        stripe_round_buf = data + off;
+        stripe_round_len = round_len;
+        stripe_round_seq = stripe_seq;
+        
+        for (i = 0; i < stripe_nlinks; i++)
+            queue_work(stripe_wq, &stripe_links[i].work);
+        
+        for (i = 0; i < stripe_nlinks; i++) {
+            flush_work(&stripe_links[i].work);
+            if (stripe_links[i].ret < 0)
+                ret = stripe_links[i].ret;
+        }
+        
+        if (ret == 0)
+            ret = stm32_stripe_verify(DIV_ROUND_UP(round_len, STM32_STRIPE_CHUNK_MAX));
+        
+        /*
+         * Firmware is now waiting for a chunk that will never come. Earlier
+         * rounds were delivered, so report them; the next write gets -EIO.
+         */
+        if (ret < 0) {
+            stripe_broken = true;
+            if (off > 0)
+                ret = off;
+            goto out;
+        }
+        
+        stripe_seq += DIV_ROUND_UP(round_len, STM32_STRIPE_CHUNK_MAX);
+    }
+    
+out:
+    up_read(&bus_sem);
+    mutex_unlock(&stripe_lock);
+    kfree(data);
+    
+    if (ret < 0)
+        return ret;
+    
+    return ret ? ret : len;
+}
+
+/* Stripe file operations structure */
+static struct file_operations stripe_fops = {
+    .owner = THIS_MODULE,
+    .open = stripe_open,
+    .release = stripe_release,
+    .write_iter = stripe_write_iter,
+    .llseek = no_llseek,
 };
 
 /* Module initialization */
 static int __init i2c_driver_init(void)
 {
-    int ret;
+    struct i2c_board_info board_info = {
+        I2C_BOARD_INFO("stm32_slave", STM32_I2C_ADDR)
+    };
+    int i, ret;
     
     pr_info("I2C Character Driver Loading...\n");
     
-    /* Allocate device number */
-    ret = alloc_chrdev_region(&dev_number, 0, 1, DRIVER_NAME);
+    /* Allocate device numbers (minor 0: raw, minor 1: capture, minor 2: stripe) */
+    ret = alloc_chrdev_region(&dev_number, 0, STM32_NR_MINORS, DRIVER_NAME);
     if (ret < 0) {
         pr_err("Failed to allocate device number\n");
         return ret;
@@ -176,59 +1760,159 @@ static int __init i2c_driver_init(void)
     ret = cdev_add(&my_cdev, dev_number, 1);
     if (ret < 0) {
         pr_err("Failed to add cdev\n");
-        unregister_chrdev_region(dev_number, 1);
-        return ret;
+        goto err_region;
+    }
+    
+    /* Capture cdev on the next minor */
+    cdev_init(&capture_cdev, &capture_fops);
+    capture_cdev.owner = THIS_MODULE;
+    
+    ret = cdev_add(&capture_cdev, dev_number + 1, 1);
+    if (ret < 0) {
+        pr_err("Failed to add capture cdev\n");
+        goto err_cdev;
+    }
+    
+    /* Stripe cdev after that */
+    cdev_init(&stripe_cdev, &stripe_fops);
+    stripe_cdev.owner = THIS_MODULE;
+    
+    ret = cdev_add(&stripe_cdev, dev_number + 2, 1);
+    if (ret < 0) {
+        pr_err("Failed to add stripe cdev\n");
+        goto err_capture_cdev;
     }
     
     /* Create device class */
     dev_class = class_create(THIS_MODULE, DEVICE_NAME);
     if (IS_ERR(dev_class)) {
         pr_err("Failed to create device class\n");
-        cdev_del(&my_cdev);
-        unregister_chrdev_region(dev_number, 1);
-        return PTR_ERR(dev_class);
+        ret = PTR_ERR(dev_class);
+        goto err_stripe_cdev;
+    }
+    
+    /* Sampling machinery must exist before sysfs can start it */
+    sample_wq = alloc_workqueue("i2c_stm32_sample", WQ_HIGHPRI, 1);
+    if (!sample_wq) {
+        pr_err("Failed to allocate sampling workqueue\n");
+        ret = -ENOMEM;
+        goto err_class;
+    }
+    INIT_WORK(&sample_work, stm32_sample_work);
+    INIT_WORK(&calib_work, stm32_calib_work);
+    hrtimer_init(&sample_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+    sample_timer.function = stm32_sample_timer;
+    
+    /* Unbound so the links of one round run on different CPUs */
+    stripe_wq = alloc_workqueue("i2c_stm32_stripe", WQ_UNBOUND | WQ_HIGHPRI,
+                                STM32_STRIPE_MAX_LINKS);
+    if (!stripe_wq) {
+        pr_err("Failed to allocate stripe workqueue\n");
+        ret = -ENOMEM;
+        goto err_wq;
     }
     
     /* Create device */
-    if (IS_ERR(device_create(dev_class, NULL, dev_number, NULL, DEVICE_NAME))) {
+    if (IS_ERR(device_create_with_groups(dev_class, NULL, dev_number, NULL,
+                                         stm32_groups, DEVICE_NAME))) {
         pr_err("Failed to create device\n");
-        class_destroy(dev_class);
-        cdev_del(&my_cdev);
-        unregister_chrdev_region(dev_number, 1);
-        return -1;
+        ret = -ENODEV;
+        goto err_stripe_wq;
+    }
+    
+    if (IS_ERR(device_create(dev_class, NULL, dev_number + 1, NULL,
+                             CAPTURE_DEVICE_NAME))) {
+        pr_err("Failed to create capture device\n");
+        ret = -ENODEV;
+        goto err_device;
+    }
+    
+    if (IS_ERR(device_create(dev_class, NULL, dev_number + 2, NULL,
+                             STRIPE_DEVICE_NAME))) {
+        pr_err("Failed to create stripe device\n");
+        ret = -ENODEV;
+        goto err_capture_device;
     }
     
     /* Get I2C adapter for i2c-1 */
     i2c_adapter = i2c_get_adapter(1);
     if (!i2c_adapter) {
         pr_err("Failed to get I2C adapter\n");
-        device_destroy(dev_class, dev_number);
-        class_destroy(dev_class);
-        cdev_del(&my_cdev);
-        unregister_chrdev_region(dev_number, 1);
-        return -ENODEV;
+        ret = -ENODEV;
+        goto err_stripe_device;
     }
     
     /* Create I2C client */
-    struct i2c_board_info board_info = {
-        I2C_BOARD_INFO("stm32_slave", STM32_I2C_ADDR)
-    };
-    
     stm32_client = i2c_new_client_device(i2c_adapter, &board_info);
     if (IS_ERR(stm32_client)) {
         pr_err("Failed to create I2C client\n");
-        i2c_put_adapter(i2c_adapter);
-        device_destroy(dev_class, dev_number);
-        class_destroy(dev_class);
-        cdev_del(&my_cdev);
-        unregister_chrdev_region(dev_number, 1);
-        return PTR_ERR(stm32_client);
+        ret = PTR_ERR(stm32_client);
+        stm32_client = NULL;
+        goto err_adapter;
+    }
+    
+    stm32_stripe_setup(&board_info);
+    
+    /* Transfer threads are optional - fall back to caller context on failure */
+    cpumask_copy(&xfer_cpumask, cpu_possible_mask);
+    if (xfer_cpus && (cpulist_parse(xfer_cpus, &xfer_cpumask) < 0 ||
+                      !cpumask_subset(&xfer_cpumask, cpu_online_mask) ||
+                      cpumask_empty(&xfer_cpumask))) {
+        pr_warn("Invalid xfer_cpus \"%s\", using all CPUs\n", xfer_cpus);
+        cpumask_copy(&xfer_cpumask, cpu_possible_mask);
+    }
+    if (xfer_rt_prio < 0 || xfer_rt_prio >= MAX_RT_PRIO) {
+        pr_warn("Invalid xfer_rt_prio %d, using SCHED_NORMAL\n", xfer_rt_prio);
+        xfer_rt_prio = 0;
+    }
+    if (xfer_thread) {
+        mutex_lock(&xfer_cfg_lock);
+        if (stm32_xfer_start() < 0)
+            stm32_xfer_stop();
+        mutex_unlock(&xfer_cfg_lock);
     }
     
+    /* Calibrated speeds from a previous run - rebinds the controllers */
+    down_write(&bus_sem);
+    for (i = 0; i < bus_speed_count && i < stripe_nlinks; i++) {
+        if (bus_speed_hz[i])
+            stm32_set_bus_speed(&stripe_links[i], bus_speed_hz[i]);
+    }
+    up_write(&bus_sem);
+    
     pr_info("I2C Character Driver Loaded Successfully\n");
     pr_info("Device created: /dev/%s\n", DEVICE_NAME);
+    pr_info("Device created: /dev/%s\n", CAPTURE_DEVICE_NAME);
+    pr_info("Device created: /dev/%s\n", STRIPE_DEVICE_NAME);
     
     return 0;
+    
+err_adapter:
+    i2c_put_adapter(i2c_adapter);
+    i2c_adapter = NULL;
+err_stripe_device:
+    device_destroy(dev_class, dev_number + 2);
+err_capture_device:
+    device_destroy(dev_class, dev_number + 1);
+err_device:
+    device_destroy(dev_class, dev_number);
+    /* sysfs may already have started the timer */
+    stm32_sample_stop();
+err_stripe_wq:
+    destroy_workqueue(stripe_wq);
+err_wq:
+    destroy_workqueue(sample_wq);
+err_class:
+    class_destroy(dev_class);
+err_stripe_cdev:
+    cdev_del(&stripe_cdev);
+err_capture_cdev:
+    cdev_del(&capture_cdev);
+err_cdev:
+    cdev_del(&my_cdev);
+err_region:
+    unregister_chrdev_region(dev_number, STM32_NR_MINORS);
+    return ret;
 }
 
 /* Module exit */
@@ -236,6 +1920,30 @@ static void __exit i2c_driver_exit(void)
 {
     pr_info("I2C Character Driver Unloading...\n");
     
+    /* Remove devices first so sysfs can no longer restart sampling */
+    device_destroy(dev_class, dev_number + 2);
+    device_destroy(dev_class, dev_number + 1);
+    device_destroy(dev_class, dev_number);
+    
+    /*
+     * Block new calibration, wait out a running one (it restarts sampling),
+     * stop sampling, then cancel again in case a failed sample requeued it.
+     */
+    WRITE_ONCE(shutting_down, true);
+    cancel_work_sync(&calib_work);
+    stm32_sample_stop();
+    cancel_work_sync(&calib_work);
+    destroy_workqueue(sample_wq);
+    
+    /* Open files pin the module, so no striped write is in flight */
+    destroy_workqueue(stripe_wq);
+    
+    /* Last transfer user is gone - stop the threads before their clients */
+    mutex_lock(&xfer_cfg_lock);
+    stm32_xfer_stop();
+    mutex_unlock(&xfer_cfg_lock);
+    stm32_stripe_teardown();
+    
     /* Cleanup I2C client */
     if (stm32_client)
         i2c_unregister_device(stm32_client);
@@ -243,11 +1951,12 @@ static void __exit i2c_driver_exit(void)
     if (i2c_adapter)
         i2c_put_adapter(i2c_adapter);
     
-    /* Cleanup character device */
-    device_destroy(dev_class, dev_number);
+    /* Cleanup character devices */
     class_destroy(dev_class);
+    cdev_del(&stripe_cdev);
+    cdev_del(&capture_cdev);
     cdev_del(&my_cdev);
-    unregister_chrdev_region(dev_number, 1);
+    unregister_chrdev_region(dev_number, STM32_NR_MINORS);
     
     pr_info("I2C Character Driver Unloaded\n");
 }
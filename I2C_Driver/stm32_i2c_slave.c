@@ -2,10 +2,16 @@
  * STM32F401RE Bare Metal I2C Slave
  * I2C1 configured as slave at address 0x30
  * Receives data from Raspberry Pi 4
+ * Optionally answers general-call (address 0x00) broadcast commands
+ * Exposes a 256-byte register file for block reads/writes
+ * I2C3 runs a second slave at 0x30; striped chunks from both buses are
+ * reassembled in sequence order into one stream
  * 
  * Connections:
  * PB8 - I2C1_SCL
  * PB9 - I2C1_SDA
+ * PA8 - I2C3_SCL (striping)
+ * PC9 - I2C3_SDA (striping)
  * PA5 - LED (Built-in LED on Nucleo board)
  */
 
@@ -16,7 +22,10 @@
 
 #define GPIOA_BASE          0x40020000
 #define GPIOA_MODER         (*(volatile unsigned int *)(GPIOA_BASE + 0x00))
+#define GPIOA_OTYPER        (*(volatile unsigned int *)(GPIOA_BASE + 0x04))
+#define GPIOA_PUPDR         (*(volatile unsigned int *)(GPIOA_BASE + 0x0C))
 #define GPIOA_ODR           (*(volatile unsigned int *)(GPIOA_BASE + 0x14))
+#define GPIOA_AFRH          (*(volatile unsigned int *)(GPIOA_BASE + 0x24))
 
 #define GPIOB_BASE          0x40020400
 #define GPIOB_MODER         (*(volatile unsigned int *)(GPIOB_BASE + 0x00))
@@ -25,24 +34,35 @@
 #define GPIOB_AFRL          (*(volatile unsigned int *)(GPIOB_BASE + 0x20))
 #define GPIOB_AFRH          (*(volatile unsigned int *)(GPIOB_BASE + 0x24))
 
+#define GPIOC_BASE          0x40020800
+#define GPIOC_MODER         (*(volatile unsigned int *)(GPIOC_BASE + 0x00))
+#define GPIOC_OTYPER        (*(volatile unsigned int *)(GPIOC_BASE + 0x04))
+#define GPIOC_PUPDR         (*(volatile unsigned int *)(GPIOC_BASE + 0x0C))
+#define GPIOC_AFRH          (*(volatile unsigned int *)(GPIOC_BASE + 0x24))
+
+/* I2C peripherals share one register layout - index by base address */
 #define I2C1_BASE           0x40005400
-#define I2C1_CR1            (*(volatile unsigned int *)(I2C1_BASE + 0x00))
-#define I2C1_CR2            (*(volatile unsigned int *)(I2C1_BASE + 0x04))
-#define I2C1_OAR1           (*(volatile unsigned int *)(I2C1_BASE + 0x08))
-#define I2C1_OAR2           (*(volatile unsigned int *)(I2C1_BASE + 0x0C))
-#define I2C1_DR             (*(volatile unsigned int *)(I2C1_BASE + 0x10))
-#define I2C1_SR1            (*(volatile unsigned int *)(I2C1_BASE + 0x14))
-#define I2C1_SR2            (*(volatile unsigned int *)(I2C1_BASE + 0x18))
-#define I2C1_CCR            (*(volatile unsigned int *)(I2C1_BASE + 0x1C))
-#define I2C1_TRISE          (*(volatile unsigned int *)(I2C1_BASE + 0x20))
+#define I2C3_BASE           0x40005C00
+#define I2C_CR1(b)          (*(volatile unsigned int *)((b) + 0x00))
+#define I2C_CR2(b)          (*(volatile unsigned int *)((b) + 0x04))
+#define I2C_OAR1(b)         (*(volatile unsigned int *)((b) + 0x08))
+#define I2C_OAR2(b)         (*(volatile unsigned int *)((b) + 0x0C))
+#define I2C_DR(b)           (*(volatile unsigned int *)((b) + 0x10))
+#define I2C_SR1(b)          (*(volatile unsigned int *)((b) + 0x14))
+#define I2C_SR2(b)          (*(volatile unsigned int *)((b) + 0x18))
+#define I2C_CCR(b)          (*(volatile unsigned int *)((b) + 0x1C))
+#define I2C_TRISE(b)        (*(volatile unsigned int *)((b) + 0x20))
 
 /* RCC Enable Bits */
 #define RCC_AHB1ENR_GPIOAEN (1 << 0)
 #define RCC_AHB1ENR_GPIOBEN (1 << 1)
+#define RCC_AHB1ENR_GPIOCEN (1 << 2)
 #define RCC_APB1ENR_I2C1EN  (1 << 21)
+#define RCC_APB1ENR_I2C3EN  (1 << 23)
 
 /* I2C CR1 Register Bits */
 #define I2C_CR1_PE          (1 << 0)
+#define I2C_CR1_ENGC        (1 << 6)
 #define I2C_CR1_ACK         (1 << 10)
 #define I2C_CR1_SWRST       (1 << 15)
 
@@ -52,23 +72,119 @@
 #define I2C_SR1_TXE         (1 << 7)
 #define I2C_SR1_STOPF       (1 << 4)
 #define I2C_SR1_BTF         (1 << 2)
+#define I2C_SR1_AF          (1 << 10)
+
+/* I2C SR2 Register Bits */
+#define I2C_SR2_GENCALL     (1 << 4)
 
 /* I2C OAR1 Register Bits */
 #define I2C_OAR1_ADD0       (1 << 0)
 #define I2C_OAR1_ADDMODE    (1 << 15)
 
+/* General call support (set to 0 to ignore broadcasts) */
+#ifndef I2C_GENERAL_CALL
+#define I2C_GENERAL_CALL    1
+#endif
+
+/* General call commands (first byte after address 0x00) */
+#define GC_CMD_RESET        0x06    /* Reset slave state (I2C spec value) */
+#define GC_CMD_CONFIG       0x08    /* Next byte is the new node config */
+#define GC_CMD_SYNC         0x0A    /* Sync point, acted on when polled */
+#define GC_CMD_LED_ON       0x0C
+#define GC_CMD_LED_OFF      0x0E
+
+/*
+ * Register file
+ * Write: first byte sets the register pointer, following bytes are stored
+ * Read:  bytes are returned from the register pointer (auto-increment)
+ */
+#define REG_FILE_SIZE       256
+#define REG_CALIB_BASE      0xC0    /* 0xC0-0xDF host speed-calibration scratch */
+#define REG_STATUS_BASE     0xE0    /* 0xE0-0xFF are read-only status */
+#define REG_STATUS_SIZE     (REG_FILE_SIZE - REG_STATUS_BASE)
+#define REG_LOOP_COUNT      0xE0    /* Main loop counter, 32-bit LE */
+#define REG_NODE_CONFIG     0xE4    /* Last general call CONFIG value */
+#define REG_SYNC_COUNT      0xE5    /* General call SYNC count, 32-bit LE */
+#define REG_STRIPE_SEQ      0xE9    /* Next expected stripe seq, 16-bit LE */
+#define REG_STRIPE_BYTES    0xEB    /* Reassembled stream bytes, 32-bit LE */
+#define REG_STRIPE_DROPS    0xEF    /* Stripe chunks dropped (wraps) */
+#define REG_STRIPE          0xF0    /* Write port: seq_lo seq_hi len data[len] */
+#define REG_STRIPE_RESET    0xF1    /* Any write restarts reassembly at seq 0 */
+
+/* Striping - number of slave buses (1 = I2C1 only, 2 = I2C1 + I2C3) */
+#ifndef I2C_STRIPE_BUSES
+#define I2C_STRIPE_BUSES    2
+#endif
+
+#define STRIPE_HDR_LEN      3
+#define STRIPE_CHUNK_MAX    32
+#define STRIPE_SLOTS        16      /* Reassembly window, in chunks */
+
+/* One striped chunk */
+struct stripe_chunk {
+    unsigned short seq;
+    unsigned char len;
+    unsigned char valid;
+    unsigned char data[STRIPE_CHUNK_MAX];
+};
+
+/* Per-bus slave state */
+struct i2c_slave {
+    unsigned int base;
+    unsigned char gc_active;
+    unsigned char gc_cmd;
+    unsigned char reg_ptr;
+    unsigned char reg_ptr_set;
+    unsigned char stripe_rx;        /* Current write targets REG_STRIPE */
+    unsigned char stripe_pos;       /* Bytes of the chunk frame received */
+    struct stripe_chunk chunk;      /* Chunk being received */
+    unsigned char status[REG_STATUS_SIZE];  /* Status snapshot for this transfer */
+};
+
 /* Global variables */
 volatile unsigned char received_data;
 volatile unsigned char data_ready = 0;
+volatile unsigned char node_config = 0;
+volatile unsigned int sync_count = 0;
+volatile unsigned char reg_file[REG_FILE_SIZE];
+volatile unsigned int loop_count = 0;
+
+struct i2c_slave slaves[I2C_STRIPE_BUSES] = {
+    { .base = I2C1_BASE },
+#if I2C_STRIPE_BUSES > 1
+    { .base = I2C3_BASE },
+#endif
+};
+
+/* Shared reassembly buffer, indexed by seq % STRIPE_SLOTS */
+struct stripe_chunk stripe_slots[STRIPE_SLOTS];
+unsigned short stripe_next_seq = 0;
+unsigned int stripe_bytes = 0;
+unsigned char stripe_drops = 0;
 
 /* Function prototypes */
 void SystemInit(void);
 void delay_ms(unsigned int ms);
 void gpio_init(void);
+void i2c1_gpio_init(void);
+void i2c3_gpio_init(void);
+void i2c_slave_init(struct i2c_slave *s);
 void i2c_init(void);
 void led_on(void);
 void led_off(void);
 void led_toggle(void);
+void gc_handle_byte(struct i2c_slave *s, unsigned char byte);
+void reg_write_byte(struct i2c_slave *s, unsigned char byte);
+void stripe_reset(void);
+void stripe_rx_byte(struct i2c_slave *s, unsigned char byte);
+void stripe_commit(struct stripe_chunk *chunk);
+void stripe_drain(void);
+void stream_process(unsigned char byte);
+void reg_put32(unsigned char reg, unsigned int value);
+void reg_update_status(void);
+void reg_snapshot_status(struct i2c_slave *s);
+unsigned char reg_read_byte(struct i2c_slave *s, unsigned char reg);
+void i2c_event_handler(struct i2c_slave *s);
 
 /* System initialization - empty for bare metal */
 void SystemInit(void)
@@ -98,14 +214,13 @@ void gpio_init(void)
     GPIOA_MODER |= (1 << (5 * 2));   /* Set as output (01) */
 }
 
-/* Initialize I2C1 as slave */
-void i2c_init(void)
+/* Configure PB8 (SCL) and PB9 (SDA) for I2C1 */
+void i2c1_gpio_init(void)
 {
     /* Enable GPIOB and I2C1 clocks */
     RCC_AHB1ENR |= RCC_AHB1ENR_GPIOBEN;
     RCC_APB1ENR |= RCC_APB1ENR_I2C1EN;
     
-    /* Configure PB8 (SCL) and PB9 (SDA) */
     /* Set to alternate function mode (10) */
     GPIOB_MODER &= ~((3 << (8 * 2)) | (3 << (9 * 2)));
     GPIOB_MODER |= (2 << (8 * 2)) | (2 << (9 * 2));
@@ -121,33 +236,84 @@ void i2c_init(void)
     /* PB8 and PB9 use AFRH register */
     GPIOB_AFRH &= ~((15 << ((8 - 8) * 4)) | (15 << ((9 - 8) * 4)));
     GPIOB_AFRH |= (4 << ((8 - 8) * 4)) | (4 << ((9 - 8) * 4));
+}
+
+/* Configure PA8 (SCL) and PC9 (SDA) for I2C3 */
+void i2c3_gpio_init(void)
+{
+    /* Enable GPIOA, GPIOC and I2C3 clocks */
+    RCC_AHB1ENR |= RCC_AHB1ENR_GPIOAEN | RCC_AHB1ENR_GPIOCEN;
+    RCC_APB1ENR |= RCC_APB1ENR_I2C3EN;
+    
+    /* Alternate function, open-drain, pull-up */
+    GPIOA_MODER &= ~(3 << (8 * 2));
+    GPIOA_MODER |= (2 << (8 * 2));
+    GPIOA_OTYPER |= (1 << 8);
+    GPIOA_PUPDR &= ~(3 << (8 * 2));
+    GPIOA_PUPDR |= (1 << (8 * 2));
+    
+    GPIOC_MODER &= ~(3 << (9 * 2));
+    GPIOC_MODER |= (2 << (9 * 2));
+    GPIOC_OTYPER |= (1 << 9);
+    GPIOC_PUPDR &= ~(3 << (9 * 2));
+    GPIOC_PUPDR |= (1 << (9 * 2));
+    
+    /* AF4 for I2C3 - both pins use AFRH */
+    GPIOA_AFRH &= ~(15 << ((8 - 8) * 4));
+    GPIOA_AFRH |= (4 << ((8 - 8) * 4));
+    GPIOC_AFRH &= ~(15 << ((9 - 8) * 4));
+    GPIOC_AFRH |= (4 << ((9 - 8) * 4));
+}
+
+/* Configure one I2C peripheral as slave */
+void i2c_slave_init(struct i2c_slave *s)
+{
+    unsigned int b = s->base;
     
-    /* Reset I2C1 */
-    I2C1_CR1 |= I2C_CR1_SWRST;
-    I2C1_CR1 &= ~I2C_CR1_SWRST;
+    /* Reset peripheral */
+    I2C_CR1(b) |= I2C_CR1_SWRST;
+    I2C_CR1(b) &= ~I2C_CR1_SWRST;
     
-    /* Configure I2C1 */
     /* APB1 clock = 16MHz */
-    I2C1_CR2 = 16;  /* 16 MHz peripheral clock */
+    I2C_CR2(b) = 16;  /* 16 MHz peripheral clock */
     
     /* Configure CCR for 100kHz */
     /* CCR = Trise / (2 * Tscl) = 16MHz / (2 * 100kHz) = 80 */
-    I2C1_CCR = 80;
+    I2C_CCR(b) = 80;
     
     /* Configure rise time */
     /* TRISE = (max_rise_time / Tpclk) + 1 = (1000ns / 62.5ns) + 1 = 17 */
-    I2C1_TRISE = 17;
+    I2C_TRISE(b) = 17;
     
     /* Set own address to 0x30 (7-bit addressing) */
-    I2C1_OAR1 = 0;
-    I2C1_OAR1 = (0x30 << 1);  /* Address in bits [7:1] */
-    I2C1_OAR1 |= (1 << 14);   /* Bit 14 should be kept at 1 by software */
+    I2C_OAR1(b) = 0;
+    I2C_OAR1(b) = (0x30 << 1);  /* Address in bits [7:1] */
+    I2C_OAR1(b) |= (1 << 14);   /* Bit 14 should be kept at 1 by software */
     
     /* Enable acknowledge */
-    I2C1_CR1 |= I2C_CR1_ACK;
+    I2C_CR1(b) |= I2C_CR1_ACK;
     
-    /* Enable I2C1 */
-    I2C1_CR1 |= I2C_CR1_PE;
+#if I2C_GENERAL_CALL
+    /* Also acknowledge general call address 0x00 */
+    I2C_CR1(b) |= I2C_CR1_ENGC;
+#endif
+    
+    /* Enable peripheral */
+    I2C_CR1(b) |= I2C_CR1_PE;
+}
+
+/* Initialize all slave buses */
+void i2c_init(void)
+{
+    int i;
+    
+    i2c1_gpio_init();
+#if I2C_STRIPE_BUSES > 1
+    i2c3_gpio_init();
+#endif
+    
+    for (i = 0; i < I2C_STRIPE_BUSES; i++)
+        i2c_slave_init(&slaves[i]);
 }
 
 /* LED control functions */
@@ -166,41 +332,288 @@ void led_toggle(void)
     GPIOA_ODR ^= (1 << 5);
 }
 
-/* I2C event handler */
-void i2c_event_handler(void)
+/* General call command handler */
+void gc_handle_byte(struct i2c_slave *s, unsigned char byte)
+{
+    /* Second byte of a two-byte command */
+    if (s->gc_cmd == GC_CMD_CONFIG) {
+        node_config = byte;
+        s->gc_cmd = 0;
+        return;
+    }
+    
+    switch (byte) {
+    case GC_CMD_RESET:
+        received_data = 0;
+        data_ready = 0;
+        node_config = 0;
+        sync_count = 0;
+        stripe_reset();
+        led_off();
+        break;
+    case GC_CMD_CONFIG:
+        s->gc_cmd = GC_CMD_CONFIG;
+        break;
+    case GC_CMD_SYNC:
+        /*
+         * Every node receives this byte on the same clock edge, but acts on
+         * it when its main loop next polls the bus. Skew between nodes is
+         * one main-loop pass (microseconds - the loop has no delay), not
+         * a single bus edge.
+         */
+        sync_count++;
+        led_toggle();
+        break;
+    case GC_CMD_LED_ON:
+        led_on();
+        break;
+    case GC_CMD_LED_OFF:
+        led_off();
+        break;
+    default:
+        /* Unknown command - ignore */
+        break;
+    }
+}
+
+/* Register file write - first byte of a transfer is the pointer */
+void reg_write_byte(struct i2c_slave *s, unsigned char byte)
+{
+    if (!s->reg_ptr_set) {
+        s->reg_ptr = byte;
+        s->reg_ptr_set = 1;
+        s->stripe_rx = (byte == REG_STRIPE);
+        s->stripe_pos = 0;
+        
+        if (byte == REG_STRIPE_RESET)
+            stripe_reset();
+        return;
+    }
+    
+    if (s->stripe_rx) {
+        stripe_rx_byte(s, byte);
+        return;
+    }
+    
+    /* Status registers are read-only */
+    if (s->reg_ptr < REG_STATUS_BASE)
+        reg_file[s->reg_ptr] = byte;
+    s->reg_ptr++;
+}
+
+/* Drop all pending chunks and expect seq 0 next */
+void stripe_reset(void)
+{
+    int i;
+    
+    for (i = 0; i < STRIPE_SLOTS; i++)
+        stripe_slots[i].valid = 0;
+    
+    stripe_next_seq = 0;
+    stripe_bytes = 0;
+    stripe_drops = 0;
+}
+
+/* Collect one byte of a chunk frame: seq_lo seq_hi len data[len] */
+void stripe_rx_byte(struct i2c_slave *s, unsigned char byte)
+{
+    struct stripe_chunk *c = &s->chunk;
+    
+    switch (s->stripe_pos) {
+    case 0:
+        c->seq = byte;
+        break;
+    case 1:
+        c->seq |= (unsigned short)byte << 8;
+        break;
+    case 2:
+        c->len = byte;
+        break;
+    default:
+        if (s->stripe_pos - STRIPE_HDR_LEN < STRIPE_CHUNK_MAX)
+            c->data[s->stripe_pos - STRIPE_HDR_LEN] = byte;
+        break;
+    }
+    
+    if (s->stripe_pos < 0xFF)
+        s->stripe_pos++;
+}
+
+/* Place a complete chunk into its reassembly slot */
+void stripe_commit(struct stripe_chunk *chunk)
+{
+    unsigned short ahead = (unsigned short)(chunk->seq - stripe_next_seq);
+    struct stripe_chunk *slot = &stripe_slots[chunk->seq % STRIPE_SLOTS];
+    int i;
+    
+    /* Duplicate, stale or beyond the window - host must resend */
+    if (ahead >= STRIPE_SLOTS || slot->valid) {
+        stripe_drops++;
+        return;
+    }
+    
+    slot->seq = chunk->seq;
+    slot->len = chunk->len;
+    for (i = 0; i < chunk->len; i++)
+        slot->data[i] = chunk->data[i];
+    slot->valid = 1;
+}
+
+/* Hand in-order chunks to the stream consumer */
+void stripe_drain(void)
+{
+    struct stripe_chunk *slot = &stripe_slots[stripe_next_seq % STRIPE_SLOTS];
+    int i;
+    
+    while (slot->valid && slot->seq == stripe_next_seq) {
+        for (i = 0; i < slot->len; i++)
+            stream_process(slot->data[i]);
+        
+        slot->valid = 0;
+        stripe_next_seq++;
+        slot = &stripe_slots[stripe_next_seq % STRIPE_SLOTS];
+    }
+}
+
+/* Reassembled stream consumer */
+void stream_process(unsigned char byte)
+{
+    stripe_bytes++;
+    
+    /* Same demo action as a direct write */
+    if (byte == 0xAA)
+        led_toggle();
+}
+
+/* Store a 32-bit value little-endian */
+void reg_put32(unsigned char reg, unsigned int value)
+{
+    reg_file[reg + 0] = (unsigned char)(value >> 0);
+    reg_file[reg + 1] = (unsigned char)(value >> 8);
+    reg_file[reg + 2] = (unsigned char)(value >> 16);
+    reg_file[reg + 3] = (unsigned char)(value >> 24);
+}
+
+/* Refresh read-only status registers */
+void reg_update_status(void)
+{
+    reg_put32(REG_LOOP_COUNT, loop_count);
+    reg_file[REG_NODE_CONFIG] = node_config;
+    reg_put32(REG_SYNC_COUNT, sync_count);
+    reg_file[REG_STRIPE_SEQ + 0] = (unsigned char)(stripe_next_seq >> 0);
+    reg_file[REG_STRIPE_SEQ + 1] = (unsigned char)(stripe_next_seq >> 8);
+    reg_put32(REG_STRIPE_BYTES, stripe_bytes);
+    reg_file[REG_STRIPE_DROPS] = stripe_drops;
+}
+
+/*
+ * Freeze status registers for one transfer. Multi-byte values are read
+ * across several loop passes (clock stretching), so they must not change
+ * between address match and STOP or the host sees torn values.
+ */
+void reg_snapshot_status(struct i2c_slave *s)
+{
+    int i;
+    
+    reg_update_status();
+    for (i = 0; i < REG_STATUS_SIZE; i++)
+        s->status[i] = reg_file[REG_STATUS_BASE + i];
+}
+
+/* Register file read - status comes from this bus's snapshot */
+unsigned char reg_read_byte(struct i2c_slave *s, unsigned char reg)
+{
+    if (reg >= REG_STATUS_BASE)
+        return s->status[reg - REG_STATUS_BASE];
+    
+    return reg_file[reg];
+}
+
+/* I2C event handler - one slave bus */
+void i2c_event_handler(struct i2c_slave *s)
 {
     volatile unsigned int sr1, sr2;
+    unsigned int b = s->base;
     
-    sr1 = I2C1_SR1;
+    sr1 = I2C_SR1(b);
+    
+    /*
+     * Stop condition detected - handled before ADDR so a chunk frame is
+     * committed even when the next START is already pending
+     */
+    if (sr1 & I2C_SR1_STOPF) {
+        /* Clear STOPF by reading SR1 and writing CR1 */
+        sr1 = I2C_SR1(b);
+        I2C_CR1(b) |= I2C_CR1_PE;
+        
+        /* Complete chunk frame - hand it to reassembly */
+        if (s->stripe_rx) {
+            if (s->stripe_pos >= STRIPE_HDR_LEN &&
+                s->chunk.len <= STRIPE_CHUNK_MAX &&
+                s->stripe_pos - STRIPE_HDR_LEN == s->chunk.len)
+                stripe_commit(&s->chunk);
+            else
+                stripe_drops++;
+            s->stripe_rx = 0;
+        }
+        
+        /* Broadcasts leave the LED under command control */
+        if (s->gc_active)
+            s->gc_active = 0;
+        else
+            led_off();
+    }
     
     /* Address matched */
     if (sr1 & I2C_SR1_ADDR) {
         /* Clear ADDR flag by reading SR1 and SR2 */
-        sr1 = I2C1_SR1;
-        sr2 = I2C1_SR2;
+        sr1 = I2C_SR1(b);
+        sr2 = I2C_SR2(b);
         
-        /* LED indication that address is matched */
-        led_on();
+        /* General call - bytes are broadcast commands */
+        if (sr2 & I2C_SR2_GENCALL) {
+            s->gc_active = 1;
+            s->gc_cmd = 0;
+        } else {
+            /* A new write starts with the register pointer */
+            s->reg_ptr_set = 0;
+            s->stripe_rx = 0;
+            
+            /* Status stays fixed until the next address match */
+            reg_snapshot_status(s);
+            
+            /* LED indication that address is matched */
+            led_on();
+        }
+    }
+    
+    /* Broadcast command received */
+    if ((sr1 & I2C_SR1_RXNE) && s->gc_active) {
+        gc_handle_byte(s, (unsigned char)(I2C_DR(b) & 0xFF));
+        sr1 &= ~I2C_SR1_RXNE;
     }
     
     /* Data received */
     if (sr1 & I2C_SR1_RXNE) {
         /* Read data from DR register */
-        received_data = (unsigned char)(I2C1_DR & 0xFF);
+        received_data = (unsigned char)(I2C_DR(b) & 0xFF);
         data_ready = 1;
+        reg_write_byte(s, received_data);
         
-        /* Check if received data is 0xAA */
-        if (received_data == 0xAA) {
+        /* Check if received data is 0xAA (striped data is checked in order) */
+        if (received_data == 0xAA && !s->stripe_rx) {
             led_toggle();
         }
     }
     
-    /* Stop condition detected */
-    if (sr1 & I2C_SR1_STOPF) {
-        /* Clear STOPF by reading SR1 and writing CR1 */
-        sr1 = I2C1_SR1;
-        I2C1_CR1 |= I2C_CR1_PE;
-        
+    /* Master reading - send next register */
+    if (sr1 & I2C_SR1_TXE) {
+        I2C_DR(b) = reg_read_byte(s, s->reg_ptr++);
+    }
+    
+    /* Master NACKed the last byte of a read */
+    if (sr1 & I2C_SR1_AF) {
+        I2C_SR1(b) &= ~I2C_SR1_AF;
         led_off();
     }
 }
@@ -227,8 +640,17 @@ int main(void)
     
     /* Main loop */
     while (1) {
-        /* Check for I2C events */
-        i2c_event_handler();
+        int i;
+        
+        /* Check for I2C events on every bus */
+        for (i = 0; i < I2C_STRIPE_BUSES; i++)
+            i2c_event_handler(&slaves[i]);
+        
+        /* Deliver striped chunks that are now in order */
+        stripe_drain();
+        
+        /* Status registers pick this up at the next address match */
+        loop_count++;
         
         /* Process received data if available */
         if (data_ready) {
@@ -236,9 +658,6 @@ int main(void)
             /* For now, just clear the flag */
             data_ready = 0;
         }
-        
-        /* Small delay */
-        delay_ms(10);
     }
     
     return 0;
@@ -1,19 +1,188 @@
 /*
  * Test application for I2C communication
  * Sends 0xAA to STM32F401RE slave
+ * Reads one timestamped sample from the capture device
+ * writev() to the register file, then reads it back
+ * Stripes a buffer across the buses, checks the firmware byte count
  */
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <string.h>
+#include <sys/uio.h>
 
 #define DEVICE_PATH "/dev/i2c_stm32"
+#define CAPTURE_PATH "/dev/i2c_stm32_capture"
+#define STRIPE_PATH "/dev/i2c_stm32_stripe"
+#define SYSFS_PATH "/sys/class/i2c_stm32/i2c_stm32"
+
+#define TEST_REG          0x10    /* General purpose register block */
+#define REG_LOOP_COUNT    0xE0
+#define REG_STRIPE_BYTES  0xEB
+#define STRIPE_TEST_LEN   100
+
+/* Capture record, must match struct stm32_sample in the driver */
+struct stm32_sample {
+    int64_t timestamp_ns;
+    uint8_t reg;
+    uint8_t len;
+    uint8_t reserved[6];
+    uint8_t data[32];
+};
+
+/* Write a value to a driver sysfs attribute */
+static int sysfs_write(const char *attr, const char *value)
+{
+    char path[128];
+    int fd;
+    ssize_t ret;
+    
+    snprintf(path, sizeof(path), "%s/%s", SYSFS_PATH, attr);
+    fd = open(path, O_WRONLY);
+    if (fd < 0) {
+        perror(path);
+        return -1;
+    }
+    
+    ret = write(fd, value, strlen(value));
+    close(fd);
+    return ret < 0 ? -1 : 0;
+}
+
+/* Read a register block: set the pointer, then read */
+static int read_regs(int fd, uint8_t reg, uint8_t *buf, size_t len)
+{
+    if (write(fd, &reg, 1) != 1)
+        return -1;
+    
+    if (read(fd, buf, len) != (ssize_t)len)
+        return -1;
+    
+    return 0;
+}
+
+/* writev() header + payload as one transaction, then read it back */
+static int test_register_file(int fd)
+{
+    uint8_t reg = TEST_REG;
+    uint8_t pattern[4] = { 0x12, 0x34, 0x56, 0x78 };
+    uint8_t readback[4];
+    struct iovec iov[2] = {
+        { .iov_base = &reg,    .iov_len = 1 },
+        { .iov_base = pattern, .iov_len = sizeof(pattern) },
+    };
+    
+    printf("\nRegister file: writev 4 bytes to 0x%02X...\n", TEST_REG);
+    if (writev(fd, iov, 2) != 1 + (ssize_t)sizeof(pattern)) {
+        perror("writev failed");
+        return -1;
+    }
+    
+    if (read_regs(fd, TEST_REG, readback, sizeof(readback)) < 0) {
+        perror("Read-back failed");
+        return -1;
+    }
+    
+    if (memcmp(pattern, readback, sizeof(pattern))) {
+        printf("FAIL: read back %02X %02X %02X %02X\n",
+               readback[0], readback[1], readback[2], readback[3]);
+        return -1;
+    }
+    
+    printf("PASS: read back matches\n");
+    return 0;
+}
+
+/* Sample the loop counter at 100 Hz and read one record */
+static int test_capture(void)
+{
+    struct stm32_sample sample;
+    uint32_t count;
+    ssize_t ret;
+    int fd;
+    
+    printf("\nCapture: sampling 0x%02X+4 at 100 Hz...\n", REG_LOOP_COUNT);
+    
+    fd = open(CAPTURE_PATH, O_RDONLY);
+    if (fd < 0) {
+        perror("Failed to open capture device");
+        return -1;
+    }
+    
+    if (sysfs_write("sample_reg", "0xE0") < 0 ||
+        sysfs_write("sample_len", "4") < 0 ||
+        sysfs_write("sample_rate_hz", "100") < 0) {
+        close(fd);
+        return -1;
+    }
+    
+    ret = read(fd, &sample, sizeof(sample));
+    sysfs_write("sample_rate_hz", "0");
+    close(fd);
+    
+    if (ret != sizeof(sample)) {
+        printf("FAIL: read returned %zd, expected %zu\n", ret, sizeof(sample));
+        return -1;
+    }
+    
+    count = sample.data[0] | (sample.data[1] << 8) |
+            (sample.data[2] << 16) | ((uint32_t)sample.data[3] << 24);
+    printf("PASS: t=%lld ns reg=0x%02X len=%u loop_count=%u\n",
+           (long long)sample.timestamp_ns, sample.reg, sample.len, count);
+    return 0;
+}
+
+/* Stripe a buffer and check the firmware reassembled all of it */
+static int test_stripe(int fd)
+{
+    uint8_t data[STRIPE_TEST_LEN];
+    uint8_t bytes[4];
+    uint32_t received;
+    ssize_t ret;
+    int sfd;
+    int i;
+    
+    printf("\nStripe: writing %d bytes...\n", STRIPE_TEST_LEN);
+    
+    /* Opening restarts reassembly, so the byte count starts at 0 */
+    sfd = open(STRIPE_PATH, O_WRONLY);
+    if (sfd < 0) {
+        perror("Failed to open stripe device");
+        return -1;
+    }
+    
+    for (i = 0; i < STRIPE_TEST_LEN; i++)
+        data[i] = (uint8_t)i;
+    
+    ret = write(sfd, data, sizeof(data));
+    close(sfd);
+    if (ret != sizeof(data)) {
+        perror("Stripe write failed");
+        return -1;
+    }
+    
+    if (read_regs(fd, REG_STRIPE_BYTES, bytes, sizeof(bytes)) < 0) {
+        perror("Read of stripe byte count failed");
+        return -1;
+    }
+    
+    received = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+    if (received != STRIPE_TEST_LEN) {
+        printf("FAIL: firmware reassembled %u bytes\n", received);
+        return -1;
+    }
+    
+    printf("PASS: firmware reassembled %u bytes\n", received);
+    return 0;
+}
 
 int main(int argc, char *argv[])
 {
     int fd;
+    int failures = 0;
     unsigned char data = 0xAA;
     ssize_t ret;
     
@@ -41,8 +210,8 @@ int main(int argc, char *argv[])
     }
     printf("Data sent successfully! (%zd bytes)\n\n", ret);
     
-    /* Optional: Read response */
-    printf("Reading response from STM32...\n");
+    /* Read response - the byte just written is also the register pointer */
+    printf("Reading registers 0x%02X.. from STM32...\n", data);
     unsigned char read_data[10];
     ret = read(fd, read_data, sizeof(read_data));
     if (ret > 0) {
@@ -52,13 +221,28 @@ int main(int argc, char *argv[])
         }
         printf("\n");
     } else {
-        printf("No data received (this is normal for write-only slave)\n");
+        perror("Read failed");
+        failures++;
     }
     
+    /* Driver paths beyond plain read/write */
+    if (test_register_file(fd) < 0)
+        failures++;
+    if (test_capture() < 0)
+        failures++;
+    if (test_stripe(fd) < 0)
+        failures++;
+    
     /* Close device */
     close(fd);
     printf("\nDevice closed.\n");
     printf("Check STM32 LED - it should toggle when 0xAA is received!\n");
     
+    if (failures) {
+        printf("\n%d test(s) failed\n", failures);
+        return -1;
+    }
+    
+    printf("\nAll tests passed\n");
     return 0;
 }